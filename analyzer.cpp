@@ -0,0 +1,645 @@
+#include "analyzer.h"
+
+#include <algorithm>
+
+#include <pthread.h>
+
+#include <functions.h>
+#include <symbols.h>
+
+namespace {
+
+//  Never escapes to Scheme code. It is an uninterned symbol, so type tests
+//  never mistake it for a function or a syntax.
+class TailCallMarker : public Symbol {
+public:
+    TailCallMarker() : Symbol("<tail call>") {
+    }
+
+    Object* Eval(Scope*) override {
+        return this;
+    }
+};
+
+}  // namespace
+
+/*************  Nodes  *************/
+void Node::MarkTailPosition() {
+}
+
+ConstantNode::ConstantNode(Object* value) : value_(value) {
+}
+
+Object* ConstantNode::Execute(Environment*) {
+    return value_;
+}
+
+void ConstantNode::Accept(NodeVisitor* visitor) {
+    visitor->Visit(this);
+}
+
+void ConstantNode::Trace(Tracer* tracer) {
+    tracer->Visit(value_);
+}
+
+Object* ConstantNode::GetValue() const {
+    return value_;
+}
+
+VariableNode::VariableNode(Scope* scope, Symbol* name) : scope_(scope), name_(name) {
+}
+
+Object* VariableNode::Execute(Environment*) {
+    return scope_->Lookup(name_);
+}
+
+void VariableNode::Accept(NodeVisitor* visitor) {
+    visitor->Visit(this);
+}
+
+void VariableNode::Trace(Tracer* tracer) {
+    tracer->Visit(scope_);
+}
+
+Symbol* VariableNode::GetName() const {
+    return name_;
+}
+
+LocalVariableNode::LocalVariableNode(size_t depth, size_t slot) : depth_(depth), slot_(slot) {
+}
+
+Object* LocalVariableNode::Execute(Environment* environment) {
+    return environment->GetAncestor(depth_)->Get(slot_);
+}
+
+void LocalVariableNode::Accept(NodeVisitor* visitor) {
+    visitor->Visit(this);
+}
+
+size_t LocalVariableNode::GetDepth() const {
+    return depth_;
+}
+
+size_t LocalVariableNode::GetSlot() const {
+    return slot_;
+}
+
+IfNode::IfNode(Node* condition, Node* true_branch, Node* false_branch)
+    : condition_(condition), true_branch_(true_branch), false_branch_(false_branch) {
+}
+
+Object* IfNode::Execute(Environment* environment) {
+    StackLimit::Check();
+    auto result = condition_->Execute(environment);
+    if (result && !IsFalse(result)) {
+        return true_branch_->Execute(environment);
+    } else if (false_branch_) {
+        return false_branch_->Execute(environment);
+    } else {
+        return nullptr;
+    }
+}
+
+void IfNode::Accept(NodeVisitor* visitor) {
+    visitor->Visit(this);
+}
+
+void IfNode::Trace(Tracer* tracer) {
+    tracer->Visit(condition_);
+    tracer->Visit(true_branch_);
+    tracer->Visit(false_branch_);
+}
+
+void IfNode::MarkTailPosition() {
+    true_branch_->MarkTailPosition();
+    if (false_branch_) {
+        false_branch_->MarkTailPosition();
+    }
+}
+
+Node* IfNode::GetCondition() const {
+    return condition_;
+}
+
+Node* IfNode::GetTrueBranch() const {
+    return true_branch_;
+}
+
+Node* IfNode::GetFalseBranch() const {
+    return false_branch_;
+}
+
+AndNode::AndNode(const std::vector<Node*>& arguments) : arguments_(arguments) {
+}
+
+Object* AndNode::Execute(Environment* environment) {
+    StackLimit::Check();
+    Object* current = True::Instance();
+    for (auto& arg : arguments_) {
+        current = arg->Execute(environment);
+        if (IsFalse(current)) {
+            return current;
+        }
+    }
+
+    return current;
+}
+
+void AndNode::Accept(NodeVisitor* visitor) {
+    visitor->Visit(this);
+}
+
+void AndNode::Trace(Tracer* tracer) {
+    for (auto& arg : arguments_) {
+        tracer->Visit(arg);
+    }
+}
+
+void AndNode::MarkTailPosition() {
+    if (!arguments_.empty()) {
+        arguments_.back()->MarkTailPosition();
+    }
+}
+
+const std::vector<Node*>& AndNode::GetArguments() const {
+    return arguments_;
+}
+
+OrNode::OrNode(const std::vector<Node*>& arguments) : arguments_(arguments) {
+}
+
+Object* OrNode::Execute(Environment* environment) {
+    StackLimit::Check();
+    Object* current = False::Instance();
+    for (auto& arg : arguments_) {
+        current = arg->Execute(environment);
+        if (!IsFalse(current)) {
+            return current;
+        }
+    }
+
+    return current;
+}
+
+void OrNode::Accept(NodeVisitor* visitor) {
+    visitor->Visit(this);
+}
+
+void OrNode::Trace(Tracer* tracer) {
+    for (auto& arg : arguments_) {
+        tracer->Visit(arg);
+    }
+}
+
+void OrNode::MarkTailPosition() {
+    if (!arguments_.empty()) {
+        arguments_.back()->MarkTailPosition();
+    }
+}
+
+const std::vector<Node*>& OrNode::GetArguments() const {
+    return arguments_;
+}
+
+DefineNode::DefineNode(Scope* scope, Symbol* name, Node* value)
+    : scope_(scope), name_(name), value_(value) {
+}
+
+Object* DefineNode::Execute(Environment* environment) {
+    StackLimit::Check();
+    auto result = value_->Execute(environment);
+    scope_->Insert(name_, result);
+    return result;
+}
+
+void DefineNode::Accept(NodeVisitor* visitor) {
+    visitor->Visit(this);
+}
+
+void DefineNode::Trace(Tracer* tracer) {
+    tracer->Visit(scope_);
+    tracer->Visit(value_);
+}
+
+Symbol* DefineNode::GetName() const {
+    return name_;
+}
+
+Node* DefineNode::GetValue() const {
+    return value_;
+}
+
+SetNode::SetNode(Scope* scope, Symbol* name, Node* value)
+    : scope_(scope), name_(name), value_(value) {
+}
+
+Object* SetNode::Execute(Environment* environment) {
+    StackLimit::Check();
+    auto result = value_->Execute(environment);
+    scope_->Set(name_, result);
+    return result;
+}
+
+void SetNode::Accept(NodeVisitor* visitor) {
+    visitor->Visit(this);
+}
+
+void SetNode::Trace(Tracer* tracer) {
+    tracer->Visit(scope_);
+    tracer->Visit(value_);
+}
+
+Symbol* SetNode::GetName() const {
+    return name_;
+}
+
+Node* SetNode::GetValue() const {
+    return value_;
+}
+
+LocalSetNode::LocalSetNode(size_t depth, size_t slot, Node* value)
+    : depth_(depth), slot_(slot), value_(value) {
+}
+
+Object* LocalSetNode::Execute(Environment* environment) {
+    StackLimit::Check();
+    auto result = value_->Execute(environment);
+    environment->GetAncestor(depth_)->Set(slot_, result);
+    return result;
+}
+
+void LocalSetNode::Accept(NodeVisitor* visitor) {
+    visitor->Visit(this);
+}
+
+void LocalSetNode::Trace(Tracer* tracer) {
+    tracer->Visit(value_);
+}
+
+size_t LocalSetNode::GetDepth() const {
+    return depth_;
+}
+
+size_t LocalSetNode::GetSlot() const {
+    return slot_;
+}
+
+Node* LocalSetNode::GetValue() const {
+    return value_;
+}
+
+LambdaNode::LambdaNode(size_t arity, size_t frame_size, const std::vector<Node*>& body)
+    : arity_(arity), frame_size_(frame_size), body_(body) {
+}
+
+Object* LambdaNode::Execute(Environment* environment) {
+    if (environment) {
+        environment->MarkCaptured();
+    }
+    return Make<LambdaClosure>(this, environment);
+}
+
+void LambdaNode::Accept(NodeVisitor* visitor) {
+    visitor->Visit(this);
+}
+
+void LambdaNode::Trace(Tracer* tracer) {
+    for (auto& node : body_) {
+        tracer->Visit(node);
+    }
+}
+
+size_t LambdaNode::GetArity() const {
+    return arity_;
+}
+
+size_t LambdaNode::GetFrameSize() const {
+    return frame_size_;
+}
+
+const std::vector<Node*>& LambdaNode::GetBody() const {
+    return body_;
+}
+
+CallNode::CallNode(Scope* scope, Cell* form, Node* function, const std::vector<Node*>& arguments)
+    : scope_(scope), form_(form), function_(function), arguments_(arguments) {
+}
+
+Object* CallNode::Execute(Environment* environment) {
+    StackLimit::Check();
+    Handle<Object> tfn = function_->Execute(environment);
+
+    if (!IsFunction(tfn)) {
+        if (IsSyntax(tfn)) {
+            //  Analyzed without frames, so it only sees globals
+            Analyzer analyzer(scope_);
+            Handle<Node> node =
+                AsSyntax(tfn)->Analyze(ToVector(form_->GetSecond()), &analyzer);
+            return node->Execute(nullptr);
+        }
+
+        if (arguments_.empty()) {
+            return tfn;
+        }
+
+        //  Extra check for a lambda function;
+        tfn = EvalObject(tfn, scope_);
+        if (!IsFunction(tfn)) {
+            throw RuntimeError(
+                "list: for 1st element, expected a function or "
+                "a syntax; got: " +
+                Print(tfn));
+        }
+    }
+
+    ArgumentWindow args(arguments_.size());
+    for (size_t it = 0; it < arguments_.size(); ++it) {
+        args[it] = arguments_[it]->Execute(environment);
+    }
+
+    auto fn = AsFunction(tfn);
+    if (auto closure = ExactCast<LambdaClosure>(fn); closure && tail_) {
+        return TailCall::Current().Schedule(closure, args);
+    }
+    return fn->Apply(scope_, args);
+}
+
+void CallNode::Accept(NodeVisitor* visitor) {
+    visitor->Visit(this);
+}
+
+void CallNode::Trace(Tracer* tracer) {
+    tracer->Visit(scope_);
+    tracer->Visit(ToObject(form_));
+    tracer->Visit(function_);
+    for (auto& arg : arguments_) {
+        tracer->Visit(arg);
+    }
+}
+
+void CallNode::MarkTailPosition() {
+    tail_ = true;
+}
+
+Node* CallNode::GetFunction() const {
+    return function_;
+}
+
+const std::vector<Node*>& CallNode::GetArguments() const {
+    return arguments_;
+}
+
+EvalNode::EvalNode(Scope* scope, Node* argument) : scope_(scope), argument_(argument) {
+}
+
+//  Evaluated forms only see globals
+Object* EvalNode::Execute(Environment* environment) {
+    StackLimit::Check();
+    Handle<Object> evaluated = argument_->Execute(environment);
+    return EvalObject(evaluated, scope_);
+}
+
+void EvalNode::Accept(NodeVisitor* visitor) {
+    visitor->Visit(this);
+}
+
+void EvalNode::Trace(Tracer* tracer) {
+    tracer->Visit(scope_);
+    tracer->Visit(argument_);
+}
+
+Node* EvalNode::GetArgument() const {
+    return argument_;
+}
+
+/*************  TailCall  *************/
+TailCall& TailCall::Current() {
+    static thread_local TailCall tail_call;
+    return tail_call;
+}
+
+Object* TailCall::Marker() {
+    static TailCallMarker marker;
+    return &marker;
+}
+
+Object* TailCall::Schedule(LambdaClosure* closure, Arguments args) {
+    closure_ = closure;
+    args_.assign(args.begin(), args.end());
+    return Marker();
+}
+
+LambdaClosure* TailCall::GetClosure() const {
+    return closure_;
+}
+
+Arguments TailCall::GetArguments() const {
+    return args_;
+}
+
+void TailCall::Clear() {
+    closure_ = nullptr;
+    args_.clear();
+}
+
+void TailCall::Trace(Tracer* tracer) {
+    tracer->Visit(closure_);
+    for (auto& arg : args_) {
+        tracer->Visit(arg);
+    }
+}
+
+/*************  StackLimit  *************/
+namespace {
+
+//  Lowest address of the stack of this thread, 0 if it is unknown
+uintptr_t GetStackEnd() {
+    static thread_local uintptr_t end = [] {
+        void* address = nullptr;
+        size_t size = 0;
+        pthread_attr_t attributes;
+        if (pthread_getattr_np(pthread_self(), &attributes) == 0) {
+            pthread_attr_getstack(&attributes, &address, &size);
+            pthread_attr_destroy(&attributes);
+        }
+        return reinterpret_cast<uintptr_t>(address);
+    }();
+    return end;
+}
+
+uintptr_t GetFrameAddress() {
+    return reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+}
+
+}  // namespace
+
+StackLimit::StackLimit(size_t budget) : previous_(limit_) {
+    auto frame = GetFrameAddress();
+    auto end = GetStackEnd();
+    auto limit = frame > budget ? frame - budget : 0;
+    if (end) {
+        limit = std::max(limit, end + kReserve);
+    }
+    limit_ = std::max(limit_, limit);
+}
+
+StackLimit::~StackLimit() {
+    limit_ = previous_;
+}
+
+void StackLimit::Check() {
+    if (GetFrameAddress() < limit_) {
+        throw RuntimeError("eval: stack limit exceeded");
+    }
+}
+
+/*************  ArgumentStack  *************/
+ArgumentStack& ArgumentStack::Current() {
+    static thread_local ArgumentStack stack;
+    return stack;
+}
+
+void ArgumentStack::Trace(Tracer* tracer) {
+    for (auto& chunk : chunks_) {
+        for (size_t it = 0; it < chunk.top; ++it) {
+            tracer->Visit(chunk.values[it]);
+        }
+    }
+}
+
+ArgumentWindow::ArgumentWindow(size_t size)
+    : stack_(ArgumentStack::Current()), previous_chunk_(stack_.current_), size_(size) {
+    auto& chunks = stack_.chunks_;
+    if (chunks.empty()) {
+        chunks.push_back({nullptr, 0, 0});
+    }
+
+    //  Chunks after the current one are empty, a too small one is replaced
+    if (chunks[stack_.current_].top + size > chunks[stack_.current_].capacity) {
+        if (chunks[stack_.current_].capacity) {
+            ++stack_.current_;
+        }
+        if (stack_.current_ == chunks.size()) {
+            chunks.push_back({nullptr, 0, 0});
+        }
+        auto& chunk = chunks[stack_.current_];
+        if (chunk.capacity < size) {
+            chunk.capacity = std::max(size, ArgumentStack::kChunkSize);
+            chunk.values = std::make_unique<Object*[]>(chunk.capacity);
+        }
+    }
+
+    auto& chunk = chunks[stack_.current_];
+    values_ = chunk.values.get() + chunk.top;
+    std::fill(values_, values_ + size, nullptr);
+    chunk.top += size;
+}
+
+ArgumentWindow::ArgumentWindow(Arguments values) : ArgumentWindow(values.size()) {
+    std::copy(values.begin(), values.end(), values_);
+}
+
+ArgumentWindow::~ArgumentWindow() {
+    stack_.chunks_[stack_.current_].top -= size_;
+    stack_.current_ = previous_chunk_;
+}
+
+/*************  Analyzer  *************/
+Analyzer::Analyzer(Scope* scope) : scope_(scope) {
+}
+
+Node* Analyzer::Analyze(Object* form) {
+    StackLimit::Check();
+    if (!form) {
+        throw RuntimeError("analyzer: empty list is not self-evaluating");
+    }
+
+    if (IsCell(form)) {
+        auto cell = AsCell(form);
+        if (auto syntax = LookupSyntax(cell->GetFirst())) {
+            return syntax->Analyze(ToVector(cell->GetSecond()), this);
+        }
+
+        Handle<Node> function = Analyze(cell->GetFirst());
+        RootedVector<Node> arguments = AnalyzeAll(ToVector(cell->GetSecond()));
+        return Make<CallNode>(scope_, cell, function, arguments);
+    }
+
+    if (IsSymbol(form) && !IsBoolean(form)) {
+        auto name = AsSymbol(form);
+        size_t depth, slot;
+        if (Resolve(name, &depth, &slot)) {
+            return Make<LocalVariableNode>(depth, slot);
+        }
+        return Make<VariableNode>(scope_, name);
+    }
+
+    //  Other atoms evaluate to themselves, or throw
+    return Make<ConstantNode>(EvalObject(form, scope_));
+}
+
+RootedVector<Node> Analyzer::AnalyzeAll(Arguments forms) {
+    RootedVector<Node> nodes;
+    for (auto& form : forms) {
+        nodes.push_back(Analyze(form));
+    }
+    return nodes;
+}
+
+Scope* Analyzer::GetScope() const {
+    return scope_;
+}
+
+void Analyzer::PushFrame(const std::vector<Symbol*>& variables) {
+    frames_.push_back(variables);
+}
+
+size_t Analyzer::PopFrame() {
+    auto size = frames_.back().size();
+    frames_.pop_back();
+    return size;
+}
+
+bool Analyzer::IsTopLevel() const {
+    return frames_.empty();
+}
+
+size_t Analyzer::DeclareLocal(Symbol* name) {
+    auto& variables = frames_.back();
+    auto it = std::find(variables.begin(), variables.end(), name);
+    if (it != variables.end()) {
+        return it - variables.begin();
+    }
+    variables.push_back(name);
+    return variables.size() - 1;
+}
+
+bool Analyzer::Resolve(Symbol* name, size_t* depth, size_t* slot) const {
+    for (size_t level = frames_.size(); level > 0; --level) {
+        auto& variables = frames_[level - 1];
+        auto it = std::find(variables.begin(), variables.end(), name);
+        if (it != variables.end()) {
+            *depth = frames_.size() - level;
+            *slot = it - variables.begin();
+            return true;
+        }
+    }
+    return false;
+}
+
+Syntax* Analyzer::LookupSyntax(Object* head) const {
+    size_t depth, slot;
+    //  Local variables shadow special forms
+    if (!IsSymbol(head) || Resolve(AsSymbol(head), &depth, &slot)) {
+        return nullptr;
+    }
+
+    auto name = AsSymbol(head);
+
+    for (auto scope = scope_; scope; scope = scope->GetPreviousScope()) {
+        if (auto value = scope->LookupInCurrentScope(name)) {
+            return IsSyntax(value) ? AsSyntax(value) : nullptr;
+        }
+    }
+    return nullptr;
+}
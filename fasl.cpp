@@ -0,0 +1,368 @@
+#include "fasl.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr std::string_view kMagic{"SCMFASL\0", 8};
+constexpr uint8_t kVersion = 1;
+
+enum class FaslTag : uint8_t {
+    NIL,
+    NUMBER,
+    //  A symbol seen for the first time spells its name, later ones refer
+    //  to it by the order of first appearance
+    SYMBOL,
+    SYMBOL_REF,
+    STRING,
+    //  A run of pairs linked by their second fields: the length, the first
+    //  elements and the tail of the last pair
+    LIST,
+    //  A pair or a string stored before with kSharedFlag, by the order of
+    //  appearance
+    SHARED_REF,
+};
+
+//  Set on the tag of a string or a run of pairs whose first pair is reached
+//  more than once, so it gets an index for SHARED_REF
+constexpr uint8_t kSharedFlag = 0x80;
+
+class FaslWriter {
+public:
+    explicit FaslWriter(std::string* out) : out_(out) {
+    }
+
+    //  Finds pairs and strings which are reached more than once, must be
+    //  called for every form before any is written
+    void CountReferences(Object* form) {
+        std::vector<Object*> pending = {form};
+        while (!pending.empty()) {
+            auto obj = pending.back();
+            pending.pop_back();
+            if (!IsCell(obj) && !IsString(obj)) {
+                continue;
+            }
+
+            auto [it, inserted] = references_.try_emplace(obj, kSingle);
+            if (!inserted) {
+                it->second = kShared;
+            } else if (IsCell(obj)) {
+                ++pairs_;
+                pending.push_back(AsCell(obj)->GetSecond());
+                pending.push_back(AsCell(obj)->GetFirst());
+            } else {
+                ++strings_;
+            }
+        }
+    }
+
+    //  Without recursion: the elements of a list are written in order, then
+    //  its tail
+    void Write(Object* form) {
+        std::vector<Object*> pending = {form};
+        std::vector<Cell*> run;
+        while (!pending.empty()) {
+            auto obj = pending.back();
+            pending.pop_back();
+
+            if (!obj) {
+                PutTag(FaslTag::NIL);
+            } else if (IsNumber(obj)) {
+                PutTag(FaslTag::NUMBER);
+                //  Zigzag keeps small negative numbers short
+                auto value = GetNumberValue(obj);
+                PutVarint((static_cast<uint64_t>(value) << 1) ^ (value < 0 ? ~uint64_t{0} : 0));
+            } else if (IsSymbol(obj)) {
+                auto [it, inserted] = symbols_.try_emplace(obj, symbols_.size());
+                if (inserted) {
+                    PutTag(FaslTag::SYMBOL);
+                    PutString(AsSymbol(obj)->GetName());
+                } else {
+                    PutTag(FaslTag::SYMBOL_REF);
+                    PutVarint(it->second);
+                }
+            } else if (IsCell(obj) || IsString(obj)) {
+                auto& index = references_.at(obj);
+                if (index >= 0) {
+                    PutTag(FaslTag::SHARED_REF);
+                    PutVarint(index);
+                    continue;
+                }
+
+                uint8_t flags = 0;
+                if (index == kShared) {
+                    index = shared_count_++;
+                    flags = kSharedFlag;
+                }
+
+                if (IsString(obj)) {
+                    PutTag(FaslTag::STRING, flags);
+                    PutString(AsString(obj)->GetValue());
+                    continue;
+                }
+
+                //  Pairs reached only through the previous one join the run
+                run.assign(1, AsCell(obj));
+                auto tail = run.back()->GetSecond();
+                while (IsCell(tail) && references_.at(tail) == kSingle) {
+                    run.push_back(AsCell(tail));
+                    tail = run.back()->GetSecond();
+                }
+
+                PutTag(FaslTag::LIST, flags);
+                PutVarint(run.size());
+                pending.push_back(tail);
+                for (auto it = run.rbegin(); it != run.rend(); ++it) {
+                    pending.push_back((*it)->GetFirst());
+                }
+            } else {
+                throw RuntimeError("fasl: cannot store " + Print(obj));
+            }
+        }
+    }
+
+    size_t GetPairCount() const {
+        return pairs_;
+    }
+
+    size_t GetStringCount() const {
+        return strings_;
+    }
+
+    void PutTag(FaslTag tag, uint8_t flags = 0) {
+        out_->push_back(static_cast<char>(static_cast<uint8_t>(tag) | flags));
+    }
+
+    void PutVarint(uint64_t value) {
+        while (value >= 0x80) {
+            out_->push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out_->push_back(static_cast<char>(value));
+    }
+
+    void PutString(std::string_view text) {
+        PutVarint(text.size());
+        out_->append(text);
+    }
+
+private:
+    //  Indices of shared objects are assigned when they are first written
+    static constexpr int64_t kSingle = -2;
+    static constexpr int64_t kShared = -1;
+
+    std::string* out_;
+    std::unordered_map<Object*, uint64_t> symbols_;
+    std::unordered_map<Object*, int64_t> references_;
+    int64_t shared_count_ = 0;
+    size_t pairs_ = 0;
+    size_t strings_ = 0;
+};
+
+class FaslReader {
+public:
+    explicit FaslReader(std::string_view data) : data_(data) {
+    }
+
+    RootedVector<Object> ReadAll() {
+        if (!IsFasl(data_)) {
+            throw RuntimeError("fasl: header expected");
+        }
+        pos_ = kMagic.size() + 1;
+
+        //  Everything read stays reachable from the forms, so collecting
+        //  while reading is wasted
+        auto pairs = GetCount();
+        auto strings = GetCount();
+        Heap::Current().ExpectLiveAllocations(pairs * sizeof(Cell) + strings * sizeof(String));
+
+        RootedVector<Object> forms;
+        auto count = GetCount();
+        forms.reserve(count);
+        for (uint64_t it = 0; it < count; ++it) {
+            forms.push_back(nullptr);
+            Read(&forms[it]);
+        }
+        if (pos_ != data_.size()) {
+            throw RuntimeError("fasl: unexpected data after the last form");
+        }
+        return forms;
+    }
+
+private:
+    //  Where a value read goes: the result, or a field of a new pair
+    struct Slot {
+        Object** result;
+        Cell* cell;
+        bool first;
+    };
+
+    //  Without recursion. A new object is stored in its slot at once, so
+    //  everything read is reachable from the result while reading goes on.
+    void Read(Object** result) {
+        std::vector<Slot> slots = {{result, nullptr, false}};
+        while (!slots.empty()) {
+            auto slot = slots.back();
+            slots.pop_back();
+
+            auto byte = GetByte();
+            bool shared = byte & kSharedFlag;
+            switch (static_cast<FaslTag>(byte & ~kSharedFlag)) {
+                case FaslTag::NIL:
+                    Store(slot, nullptr);
+                    break;
+
+                case FaslTag::NUMBER: {
+                    auto bits = GetVarint();
+                    Store(slot, MakeNumber(static_cast<int64_t>((bits >> 1) ^ (0 - (bits & 1)))));
+                    break;
+                }
+
+                case FaslTag::SYMBOL:
+                    symbols_.push_back(Intern(GetString()));
+                    Store(slot, symbols_.back());
+                    break;
+
+                case FaslTag::SYMBOL_REF:
+                    Store(slot, symbols_[GetIndex(symbols_.size())]);
+                    break;
+
+                case FaslTag::STRING: {
+                    auto value = Make<String>(std::string(GetString()));
+                    Store(slot, value);
+                    if (shared) {
+                        shared_.push_back(value);
+                    }
+                    break;
+                }
+
+                case FaslTag::LIST: {
+                    auto length = GetCount();
+                    if (length == 0) {
+                        throw RuntimeError("fasl: empty list");
+                    }
+
+                    //  Elements are filled after the whole run is linked
+                    auto first = MakeCell(nullptr, nullptr);
+                    Store(slot, first);
+                    if (shared) {
+                        shared_.push_back(first);
+                    }
+                    run_.assign(1, AsCell(first));
+                    while (run_.size() < length) {
+                        auto next = MakeCell(nullptr, nullptr);
+                        run_.back()->SetSecond(next);
+                        run_.push_back(AsCell(next));
+                    }
+
+                    slots.push_back({nullptr, run_.back(), false});
+                    for (auto it = run_.rbegin(); it != run_.rend(); ++it) {
+                        slots.push_back({nullptr, *it, true});
+                    }
+                    break;
+                }
+
+                case FaslTag::SHARED_REF:
+                    Store(slot, shared_[GetIndex(shared_.size())]);
+                    break;
+
+                default:
+                    throw RuntimeError("fasl: unknown tag");
+            }
+        }
+    }
+
+    static void Store(const Slot& slot, Object* value) {
+        if (!slot.cell) {
+            *slot.result = value;
+        } else if (slot.first) {
+            slot.cell->SetFirst(value);
+        } else {
+            slot.cell->SetSecond(value);
+        }
+    }
+
+    //  Every counted item takes at least a byte, which bounds the count
+    uint64_t GetCount() {
+        auto count = GetVarint();
+        if (count > data_.size() - pos_) {
+            throw RuntimeError("fasl: unexpected end of data");
+        }
+        return count;
+    }
+
+    uint8_t GetByte() {
+        if (pos_ >= data_.size()) {
+            throw RuntimeError("fasl: unexpected end of data");
+        }
+        return static_cast<uint8_t>(data_[pos_++]);
+    }
+
+    uint64_t GetVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            auto byte = GetByte();
+            value |= uint64_t{byte & 0x7fu} << shift;
+            if (byte < 0x80) {
+                return value;
+            }
+        }
+        throw RuntimeError("fasl: malformed number");
+    }
+
+    size_t GetIndex(size_t size) {
+        auto index = GetVarint();
+        if (index >= size) {
+            throw RuntimeError("fasl: reference to an unknown object");
+        }
+        return index;
+    }
+
+    std::string_view GetString() {
+        auto size = GetVarint();
+        if (size > data_.size() - pos_) {
+            throw RuntimeError("fasl: unexpected end of data");
+        }
+        auto text = data_.substr(pos_, size);
+        pos_ += size;
+        return text;
+    }
+
+    std::string_view data_;
+    size_t pos_ = 0;
+    std::vector<Symbol*> symbols_;
+    RootedVector<Object> shared_;
+    std::vector<Cell*> run_;
+};
+
+}  // namespace
+
+bool IsFasl(std::string_view data) {
+    return data.size() > kMagic.size() && data.substr(0, kMagic.size()) == kMagic &&
+           static_cast<uint8_t>(data[kMagic.size()]) == kVersion;
+}
+
+std::string WriteFasl(std::span<Object* const> forms) {
+    std::string out(kMagic);
+    out.push_back(static_cast<char>(kVersion));
+
+    FaslWriter writer(&out);
+    for (auto form : forms) {
+        writer.CountReferences(form);
+    }
+    writer.PutVarint(writer.GetPairCount());
+    writer.PutVarint(writer.GetStringCount());
+    writer.PutVarint(forms.size());
+    for (auto form : forms) {
+        writer.Write(form);
+    }
+    return out;
+}
+
+RootedVector<Object> ReadFasl(std::string_view data) {
+    FaslReader reader(data);
+    return reader.ReadAll();
+}
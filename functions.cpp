@@ -1,573 +1,269 @@
 #include "functions.h"
 
-/*************  Predicates  *************/
-std::shared_ptr<Object> IsNullPred::Apply(const std::shared_ptr<Scope>& scope,
-                                          const std::vector<std::shared_ptr<Object>>& args) {
+#include <algorithm>
+#include <functional>
 
-    if (args.size() != 1) {
-        throw RuntimeError("IsNullPred: wrong number of arguments");
-    }
-    if (args[0] == nullptr) {
-        return std::make_shared<True>();
-    } else {
-        return std::make_shared<False>();
-    };
+/*************  Predicates  *************/
+Object* IsNullPred::Call(Object* value) {
+    return ToBoolean(value == nullptr);
 }
 
-std::shared_ptr<Object> IsPairPred::Apply(const std::shared_ptr<Scope>& scope,
-                                          const std::vector<std::shared_ptr<Object>>& args) {
-
-    if (args.size() != 1) {
-        throw RuntimeError("IsPairPred: wrong number of arguments");
-    }
-    if (std::dynamic_pointer_cast<Cell>(args[0])) {
-        return std::make_shared<True>();
-    } else {
-        return std::make_shared<False>();
-    };
+Object* IsPairPred::Call(Object* value) {
+    return ToBoolean(IsCell(value));
 }
 
-std::shared_ptr<Object> IsNumberPred::Apply(const std::shared_ptr<Scope>& scope,
-                                            const std::vector<std::shared_ptr<Object>>& args) {
-
-    if (args.size() != 1) {
-        throw RuntimeError("IsNumberPred: wrong number of arguments");
-    }
-    if (std::dynamic_pointer_cast<Number>(args[0])) {
-        return std::make_shared<True>();
-    } else {
-        return std::make_shared<False>();
-    };
+Object* IsNumberPred::Call(Object* value) {
+    return ToBoolean(IsNumber(value));
 }
 
-std::shared_ptr<Object> IsBooleanPred::Apply(const std::shared_ptr<Scope>& scope,
-                                             const std::vector<std::shared_ptr<Object>>& args) {
-
-    if (args.size() != 1) {
-        throw RuntimeError("IsBooleanPred: wrong number of arguments");
-    }
-    auto symbol = std::dynamic_pointer_cast<Symbol>(args[0]);
-    if (symbol && (symbol->GetName() == "#t" || symbol->GetName() == "#f")) {
-        return std::make_shared<True>();
-    } else {
-        return std::make_shared<False>();
-    }
+Object* IsBooleanPred::Call(Object* value) {
+    return ToBoolean(IsBoolean(value));
 }
 
-std::shared_ptr<Object> IsSymbolPred::Apply(const std::shared_ptr<Scope>& scope,
-                                            const std::vector<std::shared_ptr<Object>>& args) {
-
-    if (args.size() != 1) {
-        throw RuntimeError("IsSymbolPred: wrong number of arguments");
-    }
-    if (std::dynamic_pointer_cast<Symbol>(args[0])) {
-        return std::make_shared<True>();
-    } else {
-        return std::make_shared<False>();
-    }
+Object* IsSymbolPred::Call(Object* value) {
+    return ToBoolean(IsSymbol(value));
 }
 
-std::shared_ptr<Object> IsListPred::Apply(const std::shared_ptr<Scope>& scope,
-                                          const std::vector<std::shared_ptr<Object>>& args) {
-
-    if (args.size() != 1) {
-        throw RuntimeError("IsListPred: wrong number of arguments");
-    }
-
-    auto cell = std::dynamic_pointer_cast<Cell>(args[0]);
-
-    if (!args[0]) {
-        return std::make_shared<True>();
-    } else if (!cell) {
-        return std::make_shared<False>();
-    } else {
-        if (!std::dynamic_pointer_cast<Number>(cell->GetFirst())) {
-            return std::make_shared<False>();
-        }
-        IsListPred is_list;
-        std::vector<std::shared_ptr<Object>> new_args;
-        new_args.push_back(cell->GetSecond());
-        return is_list.Apply(scope, new_args);
+Object* IsListPred::Call(Object* value) {
+    ListIterator it(value);
+    while (it != ListIterator()) {
+        ++it;
     }
+    return ToBoolean(it.GetRest() == nullptr);
 }
 
-std::shared_ptr<Object> IsEqualPred::Apply(const std::shared_ptr<Scope>& scope,
-                                           const std::vector<std::shared_ptr<Object>>& args) {
+Object* IsEqualPred::Apply(Scope* scope, Arguments args) {
 
     throw std::runtime_error("IsEqualPred not implemented\n");
 }
 
-std::shared_ptr<Object> IsIntegerEqualPred::Apply(
-    const std::shared_ptr<Scope>& scope, const std::vector<std::shared_ptr<Object>>& args) {
+Object* IsIntegerEqualPred::Apply(Scope* scope, Arguments args) {
 
     throw std::runtime_error("IsIntegerEqualPred not implemented\n");
 }
 
 /*************  Logical Operators  *************/
-std::shared_ptr<Object> LogicalNegation::Apply(const std::shared_ptr<Scope>& scope,
-                                               const std::vector<std::shared_ptr<Object>>& args) {
-
-    if (args.size() != 1) {
-        throw RuntimeError("LogicalNegation: wrong number of arguments");
-    }
+Object* LogicalNegation::Call(Object* value) {
+    return ToBoolean(IsFalse(value));
+}
 
-    auto symbol = std::dynamic_pointer_cast<Symbol>(args[0]);
-    if (symbol && (symbol->GetName() == "#f")) {
-        return std::make_shared<True>();
-    } else {
-        return std::make_shared<False>();
+/*************  Integer Functions  *************/
+namespace {
+
+//  True if every pair of neighbouring numbers is ordered by compare
+template <class Compare>
+Object* IsChainOrdered(const NumberArguments& numbers, Compare compare) {
+    for (size_t it = 1; it < numbers.size(); ++it) {
+        if (!compare(numbers[it - 1], numbers[it])) {
+            return False::Instance();
+        }
     }
+    return True::Instance();
 }
 
-/*************  Integer Functions  *************/
-std::shared_ptr<Object> AddInt::Apply(const std::shared_ptr<Scope>& scope,
-                                      const std::vector<std::shared_ptr<Object>>& args) {
+}  // namespace
 
+Object* AddInt::Call(const NumberArguments& numbers) {
     int64_t value = 0;
-    for (const auto& arg : args) {
-        auto new_element = arg->Eval(scope);
-        auto number = std::dynamic_pointer_cast<Number>(new_element);
-        if (!number) {
-            throw RuntimeError("+ arguments must be numbers");
-        }
-
-        value += number->GetValue();
+    for (size_t it = 0; it < numbers.size(); ++it) {
+        value += numbers[it];
     }
-
-    return std::make_shared<Number>(value);
+    return MakeNumber(value);
 }
 
-std::shared_ptr<Object> SubtractInt::Apply(const std::shared_ptr<Scope>& scope,
-                                           const std::vector<std::shared_ptr<Object>>& args) {
-
-    if (args.empty()) {
+Object* SubtractInt::Call(const NumberArguments& numbers) {
+    if (numbers.empty()) {
         throw RuntimeError("- no arguments");
     }
 
-    bool is_first = true;
-    int64_t value = 0;
-    for (const auto& arg : args) {
-        auto new_element = arg->Eval(scope);
-        auto number = std::dynamic_pointer_cast<Number>(new_element);
-        if (!number) {
-            throw RuntimeError("- arguments must be numbers");
-        }
-
-        if (is_first) {
-            value += number->GetValue();
-            is_first = false;
-        } else {
-            value -= number->GetValue();
-        }
+    int64_t value = numbers[0];
+    for (size_t it = 1; it < numbers.size(); ++it) {
+        value -= numbers[it];
     }
-
-    return std::make_shared<Number>(value);
+    return MakeNumber(value);
 }
 
-std::shared_ptr<Object> MultiplyInt::Apply(const std::shared_ptr<Scope>& scope,
-                                           const std::vector<std::shared_ptr<Object>>& args) {
-
+Object* MultiplyInt::Call(const NumberArguments& numbers) {
     int64_t value = 1;
-    for (const auto& arg : args) {
-        auto new_element = arg->Eval(scope);
-        auto number = std::dynamic_pointer_cast<Number>(new_element);
-        if (!number) {
-            throw RuntimeError("* arguments must be numbers");
-        }
-
-        value *= number->GetValue();
+    for (size_t it = 0; it < numbers.size(); ++it) {
+        value *= numbers[it];
     }
-
-    return std::make_shared<Number>(value);
+    return MakeNumber(value);
 }
 
-std::shared_ptr<Object> DivideInt::Apply(const std::shared_ptr<Scope>& scope,
-                                         const std::vector<std::shared_ptr<Object>>& args) {
-
-    if (args.empty()) {
+Object* DivideInt::Call(const NumberArguments& numbers) {
+    if (numbers.empty()) {
         throw RuntimeError("/ no arguments");
     }
 
-    bool is_first = true;
-    int64_t value = 1;
-    for (const auto& arg : args) {
-        auto new_element = arg->Eval(scope);
-        auto number = std::dynamic_pointer_cast<Number>(new_element);
-        if (!number) {
-            throw RuntimeError("/ arguments must be numbers");
-        }
-
-        if (is_first) {
-            value *= number->GetValue();
-            is_first = false;
-        } else {
-            value /= number->GetValue();
+    int64_t value = numbers[0];
+    for (size_t it = 1; it < numbers.size(); ++it) {
+        if (numbers[it] == 0) {
+            throw RuntimeError("/ division by zero");
         }
+        value /= numbers[it];
     }
-
-    return std::make_shared<Number>(value);
+    return MakeNumber(value);
 }
 
-std::shared_ptr<Object> EqualInt::Apply(const std::shared_ptr<Scope>& scope,
-                                        const std::vector<std::shared_ptr<Object>>& args) {
-
-    bool first = true;
-    int64_t prev_number = 0;
-    for (const auto& arg : args) {
-        auto new_element = arg->Eval(scope);
-        auto number = std::dynamic_pointer_cast<Number>(new_element);
-        if (!number) {
-            throw RuntimeError("* arguments must be numbers");
-        }
-
-        if (!first && prev_number != number->GetValue()) {
-            return std::make_shared<False>();
-        }
-
-        prev_number = number->GetValue();
-        first = false;
-    }
-
-    return std::make_shared<True>();
+Object* EqualInt::Call(const NumberArguments& numbers) {
+    return IsChainOrdered(numbers, std::equal_to<int64_t>());
 }
 
-std::shared_ptr<Object> GreaterInt::Apply(const std::shared_ptr<Scope>& scope,
-                                          const std::vector<std::shared_ptr<Object>>& args) {
-
-    bool first = true;
-    int64_t prev_number = 0;
-    for (const auto& arg : args) {
-        auto new_element = arg->Eval(scope);
-        auto number = std::dynamic_pointer_cast<Number>(new_element);
-        if (!number) {
-            throw RuntimeError("* arguments must be numbers");
-        }
-
-        if (!first && prev_number <= number->GetValue()) {
-            return std::make_shared<False>();
-        }
-
-        prev_number = number->GetValue();
-        first = false;
-    }
-
-    return std::make_shared<True>();
+Object* GreaterInt::Call(const NumberArguments& numbers) {
+    return IsChainOrdered(numbers, std::greater<int64_t>());
 }
 
-std::shared_ptr<Object> LessInt::Apply(const std::shared_ptr<Scope>& scope,
-                                       const std::vector<std::shared_ptr<Object>>& args) {
-
-    bool first = true;
-    int64_t prev_number = 0;
-    for (const auto& arg : args) {
-        auto new_element = arg->Eval(scope);
-        auto number = std::dynamic_pointer_cast<Number>(new_element);
-        if (!number) {
-            throw RuntimeError("* arguments must be numbers");
-        }
-
-        if (!first && prev_number >= number->GetValue()) {
-            return std::make_shared<False>();
-        }
-
-        prev_number = number->GetValue();
-        first = false;
-    }
-
-    return std::make_shared<True>();
+Object* LessInt::Call(const NumberArguments& numbers) {
+    return IsChainOrdered(numbers, std::less<int64_t>());
 }
 
-std::shared_ptr<Object> GreaterEqualInt::Apply(const std::shared_ptr<Scope>& scope,
-                                               const std::vector<std::shared_ptr<Object>>& args) {
-
-    bool first = true;
-    int64_t prev_number = 0;
-    for (const auto& arg : args) {
-        auto new_element = arg->Eval(scope);
-        auto number = std::dynamic_pointer_cast<Number>(new_element);
-        if (!number) {
-            throw RuntimeError("* arguments must be numbers");
-        }
-
-        if (!first && prev_number < number->GetValue()) {
-            return std::make_shared<False>();
-        }
-
-        prev_number = number->GetValue();
-        first = false;
-    }
-
-    return std::make_shared<True>();
+Object* GreaterEqualInt::Call(const NumberArguments& numbers) {
+    return IsChainOrdered(numbers, std::greater_equal<int64_t>());
 }
 
-std::shared_ptr<Object> LessEqualInt::Apply(const std::shared_ptr<Scope>& scope,
-                                            const std::vector<std::shared_ptr<Object>>& args) {
-
-    bool first = true;
-    int64_t prev_number = 0;
-    for (const auto& arg : args) {
-        auto new_element = arg->Eval(scope);
-        auto number = std::dynamic_pointer_cast<Number>(new_element);
-        if (!number) {
-            throw RuntimeError("* arguments must be numbers");
-        }
-
-        if (!first && prev_number > number->GetValue()) {
-            return std::make_shared<False>();
-        }
-
-        prev_number = number->GetValue();
-        first = false;
-    }
-
-    return std::make_shared<True>();
+Object* LessEqualInt::Call(const NumberArguments& numbers) {
+    return IsChainOrdered(numbers, std::less_equal<int64_t>());
 }
 
-std::shared_ptr<Object> MinInt::Apply(const std::shared_ptr<Scope>& scope,
-                                      const std::vector<std::shared_ptr<Object>>& args) {
-    if (args.empty()) {
+Object* MinInt::Call(const NumberArguments& numbers) {
+    if (numbers.empty()) {
         throw RuntimeError("min no arguments");
     }
 
-    bool first = true;
-    int64_t value = 0;
-    for (const auto& arg : args) {
-        auto new_element = arg->Eval(scope);
-        auto number = std::dynamic_pointer_cast<Number>(new_element);
-        if (!number) {
-            throw RuntimeError("min arguments must be numbers");
-        }
-
-        if (first || value > number->GetValue()) {
-            value = number->GetValue();
-            first = false;
-        }
+    int64_t value = numbers[0];
+    for (size_t it = 1; it < numbers.size(); ++it) {
+        value = std::min(value, numbers[it]);
     }
-
-    return std::make_shared<Number>(value);
+    return MakeNumber(value);
 }
 
-std::shared_ptr<Object> MaxInt::Apply(const std::shared_ptr<Scope>& scope,
-                                      const std::vector<std::shared_ptr<Object>>& args) {
-    if (args.empty()) {
+Object* MaxInt::Call(const NumberArguments& numbers) {
+    if (numbers.empty()) {
         throw RuntimeError("max no arguments");
     }
 
-    bool first = true;
-    int64_t value = 0;
-    for (const auto& arg : args) {
-        auto new_element = arg->Eval(scope);
-        auto number = std::dynamic_pointer_cast<Number>(new_element);
-        if (!number) {
-            throw RuntimeError("max arguments must be numbers");
-        }
-
-        if (first || value < number->GetValue()) {
-            value = number->GetValue();
-            first = false;
-        }
+    int64_t value = numbers[0];
+    for (size_t it = 1; it < numbers.size(); ++it) {
+        value = std::max(value, numbers[it]);
     }
-
-    return std::make_shared<Number>(value);
+    return MakeNumber(value);
 }
 
-std::shared_ptr<Object> AbsInt::Apply(const std::shared_ptr<Scope>& scope,
-                                      const std::vector<std::shared_ptr<Object>>& args) {
-
-    if (args.size() != 1) {
-        throw RuntimeError("AbsInt: wrong number of arguments");
-    }
-
-    auto new_element = args[0]->Eval(scope);
-    auto number = std::dynamic_pointer_cast<Number>(new_element);
-    if (!number) {
-        throw RuntimeError("max arguments must be numbers");
-    }
-
-    auto value = number->GetValue();
-    if (value < 0) {
-        value *= -1;
-    }
-
-    return std::make_shared<Number>(value);
+Object* AbsInt::Call(int64_t value) {
+    return MakeNumber(value < 0 ? -value : value);
 }
 
 /*************  List Functions  *************/
-std::shared_ptr<Object> ConsList::Apply(const std::shared_ptr<Scope>& scope,
-                                        const std::vector<std::shared_ptr<Object>>& args) {
-
-    if (args.size() != 2) {
-        throw RuntimeError("ConsList: wrong number of arguments");
-    }
-
-    return std::make_shared<Cell>(args[0], args[1]);
+Object* ConsList::Call(Object* first, Object* second) {
+    return MakeCell(first, second);
 }
 
-std::shared_ptr<Object> CarList::Apply(const std::shared_ptr<Scope>& scope,
-                                       const std::vector<std::shared_ptr<Object>>& args) {
-
-    if (args.size() != 1) {
-        throw RuntimeError("CarList: wrong number of arguments");
-    }
-
-    auto cell = std::dynamic_pointer_cast<Cell>(args[0]);
-    if (!cell) {
-        throw RuntimeError("CarList: argument must be a cell");
-    }
-
+Object* CarList::Call(Cell* cell) {
     return cell->GetFirst();
 }
 
-std::shared_ptr<Object> CdrList::Apply(const std::shared_ptr<Scope>& scope,
-                                       const std::vector<std::shared_ptr<Object>>& args) {
-
-    if (args.size() != 1) {
-        throw RuntimeError("CdrList: wrong number of arguments");
-    }
-
-    auto cell = std::dynamic_pointer_cast<Cell>(args[0]);
-    if (!cell) {
-        throw RuntimeError("CdrList: argument must be a cell");
-    }
-
+Object* CdrList::Call(Cell* cell) {
     return cell->GetSecond();
 }
 
-std::shared_ptr<Object> SetCarList::Apply(const std::shared_ptr<Scope>& scope,
-                                          const std::vector<std::shared_ptr<Object>>& args) {
-
-    if (args.size() != 2) {
-        throw RuntimeError("SetCarList: wrong number of arguments");
-    }
-
-    auto cell = std::dynamic_pointer_cast<Cell>(args[0]);
-    if (!cell) {
-        throw RuntimeError("SetCarList: argument must be a cell");
-    }
-
-    cell->SetFirst(args[1]);
+Object* SetCarList::Call(Cell* cell, Object* value) {
+    cell->SetFirst(value);
     return cell->GetFirst();
 }
 
-std::shared_ptr<Object> SetCdrList::Apply(const std::shared_ptr<Scope>& scope,
-                                          const std::vector<std::shared_ptr<Object>>& args) {
-
-    if (args.size() != 2) {
-        throw RuntimeError("SetCdrList: wrong number of arguments");
-    }
-
-    auto cell = std::dynamic_pointer_cast<Cell>(args[0]);
-    if (!cell) {
-        throw RuntimeError("SetCdrList: argument must be a cell");
-    }
-
-    cell->SetSecond(args[1]);
+Object* SetCdrList::Call(Cell* cell, Object* value) {
+    cell->SetSecond(value);
     return cell->GetSecond();
 }
 
-std::shared_ptr<Object> ListList::Apply(const std::shared_ptr<Scope>& scope,
-                                        const std::vector<std::shared_ptr<Object>>& args) {
-
-    if (args.empty()) {
-        return nullptr;
+Object* ListList::Call(Arguments values) {
+    //  Built from the end, the arguments stay alive in the caller's storage
+    Handle<Object> list;
+    for (size_t it = values.size(); it-- > 0;) {
+        list = MakeCell(values[it], list);
     }
-
-    ListList new_list;
-    auto new_args = std::vector(args.begin() + 1, args.end());
-    return std::make_shared<Cell>(args[0], new_list.Apply(scope, new_args));
+    return list;
 }
 
-std::shared_ptr<Object> ListRefList::Apply(const std::shared_ptr<Scope>& scope,
-                                           const std::vector<std::shared_ptr<Object>>& args) {
-
-    if (args.size() != 2) {
-        throw RuntimeError("ListRefList: wrong number of arguments");
-    }
-
-    auto cell = std::dynamic_pointer_cast<Cell>(args[0]);
-    if (!cell) {
-        throw RuntimeError("ListRefList: first argument must be a cell");
-    }
+namespace {
 
-    auto number = std::dynamic_pointer_cast<Number>(args[1]);
-    int64_t counter = 0;
-    if (!number) {
-        throw RuntimeError("ListRefList: second argument must be a number");
+//  Iterator at the element with the given index, or the end of the list if
+//  it is shorter
+template <class Self>
+ListIterator Advance(Cell* list, int64_t index) {
+    if (index < 0) {
+        throw RuntimeError(std::string(Self::kName) + ": index must not be negative");
     }
-    counter = number->GetValue();
 
-    while (counter > 0 && cell) {
-        auto new_cell = cell->GetSecond();
-        cell = std::dynamic_pointer_cast<Cell>(new_cell);
-        --counter;
+    ListIterator it(ToObject(list));
+    for (; index > 0 && it != ListIterator(); --index) {
+        ++it;
     }
-
-    if (!cell) {
-        throw RuntimeError("ListRefList: wrong reference");
+    if (index != 0) {
+        throw RuntimeError(std::string(Self::kName) + ": index is out of range");
     }
-
-    return cell->GetFirst();
+    return it;
 }
 
-std::shared_ptr<Object> ListTailList::Apply(const std::shared_ptr<Scope>& scope,
-                                            const std::vector<std::shared_ptr<Object>>& args) {
+}  // namespace
 
-    if (args.size() != 2) {
-        throw RuntimeError("ListTailList: wrong number of arguments");
-    }
-
-    auto cell = std::dynamic_pointer_cast<Cell>(args[0]);
-    if (!cell) {
-        throw RuntimeError("ListTailList: first argument must be a cell");
+Object* ListRefList::Call(Cell* list, int64_t index) {
+    auto it = Advance<ListRefList>(list, index);
+    if (it == ListIterator()) {
+        throw RuntimeError(std::string(kName) + ": index is out of range");
     }
+    return *it;
+}
 
-    auto number = std::dynamic_pointer_cast<Number>(args[1]);
-    int64_t counter = 0;
-    if (!number) {
-        throw RuntimeError("ListTailList: second argument must be a number");
-    }
-    counter = number->GetValue();
+Object* ListTailList::Call(Cell* list, int64_t index) {
+    return Advance<ListTailList>(list, index).GetRest();
+}
 
-    auto next_cell = cell->GetSecond();
-    std::vector<std::shared_ptr<Object>> results{args[0], next_cell};
+/*************  Lambda Closure  *************/
+LambdaClosure::LambdaClosure(LambdaNode* code, Environment* environment)
+    : Function(kSubtype), code_(code), environment_(environment) {
+}
 
-    while (next_cell) {
-        cell = std::dynamic_pointer_cast<Cell>(next_cell);
-        next_cell = cell->GetSecond();
-        results.push_back(next_cell);
-    }
+Object* LambdaClosure::Apply(Scope* scope, Arguments args) {
+    auto result = ExecuteBody(args);
 
-    if (counter < results.size()) {
-        return results[counter];
-    } else {
-        throw RuntimeError("ListTailList: wrong reference");
+    //  Trampoline for calls in tail position, which do not grow the C++ stack
+    auto& tail_call = TailCall::Current();
+    while (result == TailCall::Marker()) {
+        Handle<LambdaClosure> closure = tail_call.GetClosure();
+        ArgumentWindow next_args(tail_call.GetArguments());
+        tail_call.Clear();
+        result = closure->ExecuteBody(next_args);
     }
-}
 
-/*************  Lambda Closure  *************/
-LambdaClosure::LambdaClosure(const std::vector<std::string>& variables,
-                             const std::vector<std::shared_ptr<Object>>& body,
-                             const std::shared_ptr<Scope>& previous_scope)
-    : variables_(variables),
-      body_(body),
-      local_scope_(std::make_shared<Scope>(Scope(previous_scope))) {
+    return result;
 }
 
-std::shared_ptr<Object> LambdaClosure::Apply(const std::shared_ptr<Scope>& scope,
-                                             const std::vector<std::shared_ptr<Object>>& args) {
+Object* LambdaClosure::ExecuteBody(Arguments args) {
+    StackLimit::Check();
 
-    if (args.size() != variables_.size()) {
+    if (args.size() != code_->GetArity()) {
         throw RuntimeError("LambdaClosure: wrong number of arguments");
     }
 
+    //  Every call gets its own frame, arguments take the first slots
+    auto& pool = FramePool::Current();
+    Handle<Environment> frame = pool.Acquire(environment_, code_->GetFrameSize());
     for (size_t it = 0; it < args.size(); ++it) {
-        local_scope_->Insert(variables_[it], args[it]);
+        frame->Set(it, args[it]);
     }
 
-    std::shared_ptr<Object> result;
-    for (auto& cell : body_) {
-        result = cell->Eval(local_scope_);
+    Object* result = nullptr;
+    for (auto& node : code_->GetBody()) {
+        result = node->Execute(frame);
     }
 
+    pool.Release(frame);
     return result;
 }
+
+void LambdaClosure::Trace(Tracer* tracer) {
+    tracer->Visit(code_);
+    tracer->Visit(environment_);
+}
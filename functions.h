@@ -1,199 +1,301 @@
 #pragma once
 
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include <analyzer.h>
 #include <scope.h>
 #include <parser.h>
 #include <symbols.h>
 
+/*************  Primitive calling convention  *************/
+//  Primitives receive their arguments already evaluated, exactly once.
+//  A primitive derives from Primitive<Self>, names itself with kName and
+//  defines a static Call. The parameter types of Call determine how the
+//  arguments are counted and checked before the call:
+//    Object*                  any value
+//    int64_t                  a number
+//    Cell*                    a pair
+//    const NumberArguments&   all remaining arguments, each a number
+//    Arguments                all remaining arguments, any values
+
+//  Evaluated arguments which are all known to be numbers
+class NumberArguments {
+public:
+    explicit NumberArguments(Arguments args) : args_(args) {
+    }
+
+    size_t size() const {
+        return args_.size();
+    }
+
+    bool empty() const {
+        return args_.empty();
+    }
+
+    int64_t operator[](size_t index) const {
+        return AsNumber(args_[index])->GetValue();
+    }
+
+private:
+    Arguments args_;
+};
+
+template <class T>
+struct PrimitiveArgument;
+
+template <>
+struct PrimitiveArgument<Object*> {
+    static Object* Convert(Object* arg, const char*) {
+        return arg;
+    }
+};
+
+template <>
+struct PrimitiveArgument<int64_t> {
+    static int64_t Convert(Object* arg, const char* name) {
+        if (!IsNumber(arg)) {
+            throw RuntimeError(std::string(name) + ": arguments must be numbers");
+        }
+        return AsNumber(arg)->GetValue();
+    }
+};
+
+template <>
+struct PrimitiveArgument<Cell*> {
+    static Cell* Convert(Object* arg, const char* name) {
+        if (!IsCell(arg)) {
+            throw RuntimeError(std::string(name) + ": argument must be a pair");
+        }
+        return AsCell(arg);
+    }
+};
+
+template <class Self>
+class Primitive : public Function {
+public:
+    Object* Apply(Scope*, Arguments args) override {
+        return Invoke(args, &Self::Call);
+    }
+
+private:
+    template <class... Params>
+    static Object* Invoke(Arguments args, Object* (*call)(Params...)) {
+        if (args.size() != sizeof...(Params)) {
+            throw RuntimeError(std::string(Self::kName) + ": wrong number of arguments");
+        }
+        return InvokeWith(args, call, std::index_sequence_for<Params...>{});
+    }
+
+    template <class... Params, size_t... Indices>
+    static Object* InvokeWith(Arguments args, Object* (*call)(Params...),
+                              std::index_sequence<Indices...>) {
+        return call(PrimitiveArgument<Params>::Convert(args[Indices], Self::kName)...);
+    }
+
+    static Object* Invoke(Arguments args, Object* (*call)(const NumberArguments&)) {
+        for (auto arg : args) {
+            PrimitiveArgument<int64_t>::Convert(arg, Self::kName);
+        }
+        return call(NumberArguments(args));
+    }
+
+    static Object* Invoke(Arguments args, Object* (*call)(Arguments)) {
+        return call(args);
+    }
+};
+
 /*************  Predicates  *************/
-class IsNullPred : public Function {
+class IsNullPred : public Primitive<IsNullPred> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "null?";
+    static Object* Call(Object* value);
 };
 
-class IsPairPred : public Function {
+class IsPairPred : public Primitive<IsPairPred> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "pair?";
+    static Object* Call(Object* value);
 };
 
-class IsNumberPred : public Function {
+class IsNumberPred : public Primitive<IsNumberPred> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "number?";
+    static Object* Call(Object* value);
 };
 
-class IsBooleanPred : public Function {
+class IsBooleanPred : public Primitive<IsBooleanPred> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "boolean?";
+    static Object* Call(Object* value);
 };
 
-class IsSymbolPred : public Function {
+class IsSymbolPred : public Primitive<IsSymbolPred> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "symbol?";
+    static Object* Call(Object* value);
 };
 
-class IsListPred : public Function {
+class IsListPred : public Primitive<IsListPred> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "list?";
+    static Object* Call(Object* value);
 };
 
 class IsEqualPred : public Function {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    Object* Apply(Scope* scope, Arguments args) override;
 };
 
 class IsIntegerEqualPred : public Function {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    Object* Apply(Scope* scope, Arguments args) override;
 };
 
 /*************  Logical Operators  *************/
-class LogicalNegation : public Function {
+class LogicalNegation : public Primitive<LogicalNegation> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "not";
+    static Object* Call(Object* value);
 };
 
 /*************  Integer Functions  *************/
-class AddInt : public Function {
+class AddInt : public Primitive<AddInt> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "+";
+    static Object* Call(const NumberArguments& numbers);
 };
 
-class SubtractInt : public Function {
+class SubtractInt : public Primitive<SubtractInt> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "-";
+    static Object* Call(const NumberArguments& numbers);
 };
 
-class MultiplyInt : public Function {
+class MultiplyInt : public Primitive<MultiplyInt> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "*";
+    static Object* Call(const NumberArguments& numbers);
 };
 
-class DivideInt : public Function {
+class DivideInt : public Primitive<DivideInt> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "/";
+    static Object* Call(const NumberArguments& numbers);
 };
 
-class EqualInt : public Function {
+class EqualInt : public Primitive<EqualInt> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "=";
+    static Object* Call(const NumberArguments& numbers);
 };
 
-class GreaterInt : public Function {
+class GreaterInt : public Primitive<GreaterInt> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = ">";
+    static Object* Call(const NumberArguments& numbers);
 };
 
-class LessInt : public Function {
+class LessInt : public Primitive<LessInt> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "<";
+    static Object* Call(const NumberArguments& numbers);
 };
 
-class GreaterEqualInt : public Function {
+class GreaterEqualInt : public Primitive<GreaterEqualInt> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = ">=";
+    static Object* Call(const NumberArguments& numbers);
 };
 
-class LessEqualInt : public Function {
+class LessEqualInt : public Primitive<LessEqualInt> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "<=";
+    static Object* Call(const NumberArguments& numbers);
 };
 
-class MinInt : public Function {
+class MinInt : public Primitive<MinInt> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "min";
+    static Object* Call(const NumberArguments& numbers);
 };
 
-class MaxInt : public Function {
+class MaxInt : public Primitive<MaxInt> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "max";
+    static Object* Call(const NumberArguments& numbers);
 };
 
-class AbsInt : public Function {
+class AbsInt : public Primitive<AbsInt> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "abs";
+    static Object* Call(int64_t value);
 };
 
 /*************  List Functions  *************/
-class ConsList : public Function {
+class ConsList : public Primitive<ConsList> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "cons";
+    static Object* Call(Object* first, Object* second);
 };
 
-class CarList : public Function {
+class CarList : public Primitive<CarList> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "car";
+    static Object* Call(Cell* cell);
 };
 
-class CdrList : public Function {
+class CdrList : public Primitive<CdrList> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "cdr";
+    static Object* Call(Cell* cell);
 };
 
-class SetCarList : public Function {
+class SetCarList : public Primitive<SetCarList> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "set-car!";
+    static Object* Call(Cell* cell, Object* value);
 };
 
-class SetCdrList : public Function {
+class SetCdrList : public Primitive<SetCdrList> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "set-cdr!";
+    static Object* Call(Cell* cell, Object* value);
 };
 
-class ListList : public Function {
+class ListList : public Primitive<ListList> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "list";
+    static Object* Call(Arguments values);
 };
 
-class ListRefList : public Function {
+class ListRefList : public Primitive<ListRefList> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "list-ref";
+    static Object* Call(Cell* list, int64_t index);
 };
 
-class ListTailList : public Function {
+class ListTailList : public Primitive<ListTailList> {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr const char* kName = "list-tail";
+    static Object* Call(Cell* list, int64_t index);
 };
 
 /*************  Lambda Closure  *************/
-class LambdaClosure : public Function {
+class LambdaClosure final : public Function {
 public:
-    LambdaClosure(const std::vector<std::string>& variables,
-                  const std::vector<std::shared_ptr<Object>>& body,
-                  const std::shared_ptr<Scope>& scope);
+    static constexpr ObjectSubtype kSubtype = ObjectSubtype::LAMBDA_CLOSURE;
 
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    LambdaClosure(LambdaNode* code, Environment* environment);
+
+    Object* Apply(Scope* scope, Arguments args) override;
+    void Trace(Tracer* tracer) override;
 
 private:
-    std::vector<std::string> variables_;
-    std::vector<std::shared_ptr<Object>> body_;
-    std::shared_ptr<Scope> local_scope_;
+    //  May return TailCall::Marker()
+    Object* ExecuteBody(Arguments args);
+
+    LambdaNode* code_;
+    Environment* environment_;
 };
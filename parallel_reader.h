@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include <heap.h>
+#include <parser.h>
+
+//  Offsets which split the input into chunks of about chunk_size bytes,
+//  starting with 0 and ending with the size of the input. Every chunk
+//  consists of whole top-level forms and reads the same as it would in
+//  place: splits are made outside of lists and strings, not after a quote,
+//  and right before a token which does not start with a sign, as a sign
+//  may only be read as a number at the start.
+std::vector<size_t> FindFormBoundaries(std::string_view input, size_t chunk_size);
+
+//  Top-level forms of the input in order. Chunks of the input are read
+//  concurrently by the given number of threads, each into a heap of its
+//  own, which is adopted by the heap of the calling thread afterwards.
+//  Errors are reported as by a sequential read: the first one in the input.
+RootedVector<Object> ReadFormsParallel(std::string_view input, size_t threads);
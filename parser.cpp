@@ -1,20 +1,18 @@
 #include <parser.h>
+#include <analyzer.h>
+#include <symbols.h>
 
-/*************  Object  *************/
-bool Object::IsFalse() const {
-    return false;
-}
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
 
-Object::Object(ObjectType type) : type_(type) {
-}
-
-ObjectType Object::GetType() {
-    return type_;
+/*************  Object  *************/
+Object::Object(ObjectType type, ObjectSubtype subtype) : type_(type), subtype_(subtype) {
 }
 
 /*************  Number  *************/
-std::shared_ptr<Object> Number::Eval(const std::shared_ptr<Scope>&) {
-    return shared_from_this();
+Object* Number::Eval(Scope*) {
+    return this;
 };
 
 void Number::PrintObjectToOstream(std::ostream* out) {
@@ -29,8 +27,8 @@ int64_t Number::GetValue() const {
 }
 
 /*************  Symbol  *************/
-std::shared_ptr<Object> Symbol::Eval(const std::shared_ptr<Scope>& scope) {
-    return scope->Lookup(name_);
+Object* Symbol::Eval(Scope* scope) {
+    return scope->Lookup(this);
 }
 
 void Symbol::PrintObjectToOstream(std::ostream* out) {
@@ -38,14 +36,78 @@ void Symbol::PrintObjectToOstream(std::ostream* out) {
 }
 
 Symbol::Symbol(std::string name) : Object(ObjectType::SYMBOL), name_(std::move(name)) {
+    Heap::MarkPermanent(this);
 }
 
-std::string Symbol::GetName() const {
+const std::string& Symbol::GetName() const {
     return name_;
 }
 
+uint32_t Symbol::GetId() const {
+    return id_;
+}
+
+/*************  SymbolTable  *************/
+class SymbolTable {
+public:
+    SymbolTable() {
+        Add(True::Instance());
+        Add(False::Instance());
+    }
+
+    Symbol* Intern(std::string_view name) {
+        std::lock_guard guard(mutex_);
+        auto it = symbols_.find(name);
+        if (it != symbols_.end()) {
+            return it->second;
+        }
+
+        auto symbol = new Symbol(std::string(name));
+        Add(symbol);
+        return symbol;
+    }
+
+private:
+    void Add(Symbol* symbol) {
+        symbol->id_ = static_cast<uint32_t>(symbols_.size());
+        symbols_.emplace(symbol->GetName(), symbol);
+    }
+
+    std::mutex mutex_;
+    //  Keys point into the names of the symbols, which are never freed
+    std::unordered_map<std::string_view, Symbol*> symbols_;
+};
+
+Symbol* Intern(std::string_view name) {
+    static SymbolTable* table = new SymbolTable();
+    return table->Intern(name);
+}
+
+/*************  String  *************/
+Object* String::Eval(Scope*) {
+    return this;
+}
+
+void String::PrintObjectToOstream(std::ostream* out) {
+    *out << '"';
+    for (auto ch : value_) {
+        if (ch == '"' || ch == '\\') {
+            *out << '\\';
+        }
+        *out << ch;
+    }
+    *out << '"';
+}
+
+String::String(std::string value) : Object(ObjectType::STRING), value_(std::move(value)) {
+}
+
+const std::string& String::GetValue() const {
+    return value_;
+}
+
 /*************  Function  *************/
-std::shared_ptr<Object> Function::Eval(const std::shared_ptr<Scope>& scope) {
+Object* Function::Eval(Scope* scope) {
     throw RuntimeError("cannot evaluate a function");
 }
 
@@ -53,11 +115,11 @@ void Function::PrintObjectToOstream(std::ostream* out) {
     *out << "<function>";
 }
 
-Function::Function() : Object(ObjectType::FUNCTION) {
+Function::Function(ObjectSubtype subtype) : Object(ObjectType::FUNCTION, subtype) {
 }
 
 /*************  Syntax  *************/
-std::shared_ptr<Object> Syntax::Eval(const std::shared_ptr<Scope>& scope) {
+Object* Syntax::Eval(Scope* scope) {
     throw RuntimeError("cannot evaluate a syntax");
 }
 
@@ -65,53 +127,25 @@ void Syntax::PrintObjectToOstream(std::ostream* out) {
     *out << "<syntax>";
 }
 
-Syntax::Syntax() : Object(ObjectType::SYNTAX) {
+Syntax::Syntax(ObjectSubtype subtype) : Object(ObjectType::SYNTAX, subtype) {
 }
 
 /*************  Cell  *************/
-std::shared_ptr<Object> Cell::Eval(const std::shared_ptr<Scope>& scope) {
-    auto tfn = first_->Eval(scope);
-    auto fn = std::dynamic_pointer_cast<Function>(tfn);
-    auto syntax = std::dynamic_pointer_cast<Syntax>(tfn);
-
-    if (!fn && !syntax && second_ == nullptr) {
-        return tfn;
-    }
-
-    if (!fn && !syntax) {
-        //  Extra check for a lambda function;
-        tfn = tfn->Eval(scope);
-        fn = std::dynamic_pointer_cast<Function>(tfn);
-        if (!fn) {
-            throw RuntimeError(
-                "list: for 1st element, expected a function or "
-                "a syntax; got: " +
-                Print(tfn));
-        }
-    }
-
-    std::vector<std::shared_ptr<Object>> args = ToVector(second_);
-    if (fn) {
-        for (auto& arg : args) {
-            arg = arg->Eval(scope);
-        }
-        return fn->Apply(scope, args);
-    } else {
-        return syntax->Apply(scope, args);
-    }
+Object* Cell::Eval(Scope* scope) {
+    Analyzer analyzer(scope);
+    Handle<Node> node = analyzer.Analyze(ToObject(this));
+    return node->Execute(nullptr);
 }
 
 void Cell::PrintObjectToOstream(std::ostream* out) {
     *out << "(";
     PrintTo(first_, out);
 
-    auto current = std::dynamic_pointer_cast<Cell>(shared_from_this());
-    auto next = std::dynamic_pointer_cast<Cell>(second_);
-    while (next) {
+    auto current = this;
+    while (IsCell(current->GetSecond())) {
+        current = AsCell(current->GetSecond());
         *out << " ";
-        PrintTo(next->GetFirst(), out);
-        current = next;
-        next = std::dynamic_pointer_cast<Cell>(next->GetSecond());
+        PrintTo(current->GetFirst(), out);
     }
 
     if (current->GetSecond()) {
@@ -122,55 +156,28 @@ void Cell::PrintObjectToOstream(std::ostream* out) {
     *out << ")";
 }
 
-Cell::Cell(std::shared_ptr<Object> first, std::shared_ptr<Object> second)
-    : Object(ObjectType::CELL), first_(std::move(first)), second_(std::move(second)) {
-}
-
-std::shared_ptr<Object> Cell::GetFirst() const {
-    return first_;
-}
-
-std::shared_ptr<Object> Cell::GetSecond() const {
-    return second_;
-}
-
-void Cell::SetFirst(const std::shared_ptr<Object>& new_first) {
-    first_ = new_first;
-}
-
-void Cell::SetSecond(const std::shared_ptr<Object>& new_second) {
-    second_ = new_second;
-}
-
 /*************  Helper functions  *************/
-std::vector<std::shared_ptr<Object>> ToVector(const std::shared_ptr<Object>& head) {
-    std::vector<std::shared_ptr<Object>> elements;
-    if (head == nullptr) {
-        return elements;
+Object* EvalObject(Object* obj, Scope* scope) {
+    if (IsFixnum(obj)) {
+        return obj;
     }
-
-    if (IsCell(head)) {
-        auto current = std::dynamic_pointer_cast<Cell>(head);
-        auto vec_tail = ToVector(current->GetSecond());
-        elements.push_back(current->GetFirst());
-        elements.insert(elements.end(), vec_tail.begin(), vec_tail.end());
-    } else {
-        elements.push_back(head);
+    if (IsCell(obj)) {
+        return AsCell(obj)->Eval(scope);
     }
-
-    return elements;
-}
-
-bool IsNumber(const std::shared_ptr<Object>& obj) {
-    return obj->GetType() == ObjectType::NUMBER;
+    return obj->Eval(scope);
 }
 
-bool IsCell(const std::shared_ptr<Object>& obj) {
-    return obj->GetType() == ObjectType::CELL;
-}
+std::vector<Object*> ToVector(Object* head) {
+    std::vector<Object*> elements;
+    ListIterator it(head);
+    for (; it != ListIterator(); ++it) {
+        elements.push_back(*it);
+    }
 
-bool IsSymbol(const std::shared_ptr<Object>& obj) {
-    return obj->GetType() == ObjectType::SYMBOL;
+    if (it.GetRest()) {
+        elements.push_back(it.GetRest());
+    }
+    return elements;
 }
 
 bool IsBracketClose(Token tok) {
@@ -193,91 +200,208 @@ bool IsDot(Token tok) {
 // <expr>     :: <item> { <list>}
 // <list>     :: () | (<expr> ... <expr) | (<expr> ... <expr> . <list>)
 
-//  Read an arbitrary expression
-std::shared_ptr<Object> Read(Tokenizer* tokenizer) {
-    auto tok = tokenizer->GetToken();
-    tokenizer->Next();
-
-    if (ConstantToken* num = std::get_if<ConstantToken>(&tok)) {
-        return std::make_shared<Number>(num->value);
-
-    } else if (SymbolToken* symb = std::get_if<SymbolToken>(&tok)) {
-        return std::make_shared<Symbol>(symb->name);
-
-    } else if (BracketToken* brac = std::get_if<BracketToken>(&tok)) {
-        if (*brac == BracketToken::OPEN) {
-            return ReadList(tokenizer);
-        } else {
-            throw SyntaxError{"Incorrect expression: misplaced )"};
+namespace {
+
+//  Escapes are a backslash followed by the character itself, except for \n
+//  and \t
+std::string Unescape(std::string_view text) {
+    std::string value;
+    value.reserve(text.size());
+    for (size_t it = 0; it < text.size(); ++it) {
+        if (text[it] != '\\' || it + 1 == text.size()) {
+            value += text[it];
+            continue;
         }
-    } else if (std::get_if<QuoteToken>(&tok)) {
-        auto new_cell = std::make_shared<Cell>(Read(tokenizer), nullptr);
-        return std::make_shared<Cell>(std::make_shared<Symbol>("quote"), new_cell);
-    } else {
-
-        throw SyntaxError{
-            "Incorrect expression: number, symbol, ' or ( "
-            "expected"};
+        auto ch = text[++it];
+        value += ch == 'n' ? '\n' : ch == 't' ? '\t' : ch;
     }
+    return value;
 }
 
-//  Read a list, a pair, or a list with a dot at the end
-std::shared_ptr<Object> ReadList(Tokenizer* tokenizer) {
-    if (tokenizer->IsEnd()) {
-        throw SyntaxError{"Incorrect list: premature end of stream"};
+//  Reads with an explicit stack of unfinished lists and quotes instead of
+//  recursion, so the depth of nesting is not limited by the C++ stack.
+//  Unfinished lists are roots, their cells stay alive while reading.
+class Reader : public RootBase {
+public:
+    explicit Reader(Tokenizer* tokenizer) : tokenizer_(tokenizer) {
     }
 
-    auto tok = tokenizer->GetToken();
+    //  Read an arbitrary expression
+    Object* ReadExpression() {
+        return Run(false);
+    }
 
-    //  Empty list
-    if (IsBracketClose(tok)) {
-        tokenizer->Next();
-        return nullptr;
+    //  Read the rest of a list after its opening bracket
+    Object* ReadListBody() {
+        return Run(true);
     }
 
-    auto left = Read(tokenizer);
-    tok = tokenizer->GetToken();
+private:
+    struct Frame {
+        enum class Kind { QUOTE, ELEMENTS, TAIL };
 
-    auto result = std::make_shared<Cell>(left, nullptr);
-    auto previous = result;
+        Kind kind;
+        Object* head = nullptr;
+        Cell* last = nullptr;
+    };
 
-    while (!IsDot(tok) && !IsBracketClose(tok) && !tokenizer->IsEnd()) {
-        auto new_expression = Read(tokenizer);
-        auto new_cell = std::make_shared<Cell>(new_expression, nullptr);
-        previous->SetSecond(new_cell);
-        previous = new_cell;
-        tok = tokenizer->GetToken();
+    void Trace(Tracer* tracer) override {
+        for (auto& frame : frames_) {
+            tracer->Visit(frame.head);
+        }
     }
 
-    //  End of list in reduced form
-    if (IsBracketClose(tok)) {
-        tokenizer->Next();
-        return result;
-    }
+    Object* Run(bool in_list) {
+        //  Either the next expression is read, or a finished one is
+        //  handed to the innermost unfinished frame
+        bool have_value = false;
+        Object* value = nullptr;
+        if (in_list) {
+            have_value = OpenList(&value);
+        }
 
-    if (tokenizer->IsEnd()) {
-        throw SyntaxError{"Incorrect list: premature end"};
+        while (true) {
+            if (!have_value) {
+                have_value = ReadItem(&value);
+                continue;
+            }
+            if (frames_.empty()) {
+                return value;
+            }
+            have_value = Complete(&value);
+        }
     }
 
-    //  tok is dot
-    tokenizer->Next();
-    auto right = Read(tokenizer);
+    //  Returns false if a nested expression has to be read first
+    bool ReadItem(Object** value) {
+        //  Symbol names refer to the input only until the tokenizer moves on
+        auto& tok = tokenizer_->GetToken();
 
-    if (tokenizer->IsEnd()) {
-        throw SyntaxError{"Incorrect list: premature end after dot"};
+        if (auto num = std::get_if<ConstantToken>(&tok)) {
+            *value = MakeNumber(num->value);
+            tokenizer_->Next();
+            return true;
+
+        } else if (auto symb = std::get_if<SymbolToken>(&tok)) {
+            *value = Intern(symb->name);
+            tokenizer_->Next();
+            return true;
+
+        } else if (auto str = std::get_if<StringToken>(&tok)) {
+            if (!str->terminated) {
+                throw SyntaxError{"Incorrect string: \" is missing"};
+            }
+            *value = Make<String>(Unescape(str->text));
+            tokenizer_->Next();
+            return true;
+
+        } else if (auto brac = std::get_if<BracketToken>(&tok)) {
+            if (*brac == BracketToken::OPEN) {
+                tokenizer_->Next();
+                return OpenList(value);
+            } else {
+                throw SyntaxError{"Incorrect expression: misplaced )"};
+            }
+        } else if (std::get_if<QuoteToken>(&tok)) {
+            tokenizer_->Next();
+            frames_.push_back({Frame::Kind::QUOTE});
+            return false;
+        } else {
+
+            throw SyntaxError{
+                "Incorrect expression: number, symbol, string, ' or ( "
+                "expected"};
+        }
     }
 
-    tok = tokenizer->GetToken();
-    tokenizer->Next();
+    //  Called after an opening bracket
+    bool OpenList(Object** value) {
+        if (tokenizer_->IsEnd()) {
+            throw SyntaxError{"Incorrect list: premature end of stream"};
+        }
+
+        //  Empty list
+        if (IsBracketClose(tokenizer_->GetToken())) {
+            tokenizer_->Next();
+            *value = nullptr;
+            return true;
+        }
 
-    if (!IsBracketClose(tok)) {
-        throw SyntaxError{"Incorrect list: ) is missing"};
+        frames_.push_back({Frame::Kind::ELEMENTS});
+        return false;
     }
 
-    if (previous == result) {  //  Only one expression before the dot
-        return std::make_shared<Cell>(std::move(left), std::move(right));
-    } else {
-        previous->SetSecond(right);
-        return result;
+    //  Hands a finished expression to the innermost frame. Returns true
+    //  if the frame is finished too.
+    bool Complete(Object** value) {
+        auto& frame = frames_.back();
+
+        if (frame.kind == Frame::Kind::QUOTE) {
+            Handle<Object> quoted = MakeCell(*value, nullptr);
+            *value = MakeCell(Intern("quote"), quoted);
+            frames_.pop_back();
+            return true;
+        }
+
+        if (frame.kind == Frame::Kind::TAIL) {
+            if (tokenizer_->IsEnd()) {
+                throw SyntaxError{"Incorrect list: premature end after dot"};
+            }
+
+            auto tok = tokenizer_->GetToken();
+            tokenizer_->Next();
+
+            if (!IsBracketClose(tok)) {
+                throw SyntaxError{"Incorrect list: ) is missing"};
+            }
+
+            frame.last->SetSecond(*value);
+            *value = frame.head;
+            frames_.pop_back();
+            return true;
+        }
+
+        auto cell = MakeCell(*value, nullptr);
+        if (frame.last) {
+            frame.last->SetSecond(cell);
+        } else {
+            frame.head = cell;
+        }
+        frame.last = AsCell(cell);
+
+        auto tok = tokenizer_->GetToken();
+
+        //  End of list in reduced form
+        if (IsBracketClose(tok)) {
+            tokenizer_->Next();
+            *value = frame.head;
+            frames_.pop_back();
+            return true;
+        }
+
+        if (tokenizer_->IsEnd()) {
+            throw SyntaxError{"Incorrect list: premature end"};
+        }
+
+        if (IsDot(tok)) {
+            tokenizer_->Next();
+            frame.kind = Frame::Kind::TAIL;
+        }
+        return false;
     }
+
+    Tokenizer* tokenizer_;
+    std::vector<Frame> frames_;
+};
+
+}  // namespace
+
+Object* Read(Tokenizer* tokenizer) {
+    Reader reader(tokenizer);
+    return reader.ReadExpression();
+}
+
+Object* ReadList(Tokenizer* tokenizer) {
+    Reader reader(tokenizer);
+    return reader.ReadListBody();
 }
@@ -2,33 +2,52 @@
 
 #include <vector>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <memory>
+#include <span>
+#include <string_view>
+#include <type_traits>
 
 #include <tokenizer.h>
+#include <heap.h>
 #include <scope.h>
 #include <errors.h>
 #include <printer.h>
 
 class Scope;
+class Node;
+class Analyzer;
 
-enum class ObjectType { NUMBER, CELL, SYMBOL, FUNCTION, SYNTAX };
+enum class ObjectType { NUMBER, SYMBOL, STRING, FUNCTION, SYNTAX };
 
-class Object : public std::enable_shared_from_this<Object> {
+//  Final classes which ExactCast recognizes; NONE for all other objects
+enum class ObjectSubtype { NONE, LAMBDA_CLOSURE, VM_CLOSURE, DEFINE_SYNTAX };
+
+class Object : public HeapObject {
 public:
-    virtual std::shared_ptr<Object> Eval(const std::shared_ptr<Scope>& scope) = 0;
+    virtual Object* Eval(Scope* scope) = 0;
     virtual void PrintObjectToOstream(std::ostream* out) = 0;
-    virtual bool IsFalse() const;
     virtual ~Object() = default;
-    Object(ObjectType type);
-    ObjectType GetType();
+    Object(ObjectType type, ObjectSubtype subtype = ObjectSubtype::NONE);
+
+    ObjectType GetType() const {
+        return type_;
+    }
+
+    ObjectSubtype GetSubtype() const {
+        return subtype_;
+    }
 
 private:
     const ObjectType type_;
+    const ObjectSubtype subtype_;
 };
 
 class Number : public Object {
 public:
-    std::shared_ptr<Object> Eval(const std::shared_ptr<Scope>&) override;
+    Object* Eval(Scope*) override;
     void PrintObjectToOstream(std::ostream* out) override;
     explicit Number(int64_t number);
     int64_t GetValue() const;
@@ -37,58 +56,310 @@ private:
     int64_t value_;
 };
 
+//  Symbols are interned: every name has a single permanent Symbol object,
+//  so symbols are compared by pointer and scopes are keyed by symbol ids.
 class Symbol : public Object {
 public:
-    std::shared_ptr<Object> Eval(const std::shared_ptr<Scope>& scope) override;
+    Object* Eval(Scope* scope) override;
     void PrintObjectToOstream(std::ostream* out) override;
+    const std::string& GetName() const;
+    uint32_t GetId() const;
+
+protected:
     explicit Symbol(std::string name);
-    std::string GetName() const;
 
 private:
+    friend class SymbolTable;
+
     std::string name_;
+    uint32_t id_ = 0;
+};
+
+//  Returns the symbol with the given name, creating it on first use
+Symbol* Intern(std::string_view name);
+
+//  String literals evaluate to themselves
+class String : public Object {
+public:
+    Object* Eval(Scope*) override;
+    void PrintObjectToOstream(std::ostream* out) override;
+    explicit String(std::string value);
+    const std::string& GetValue() const;
+
+private:
+    std::string value_;
 };
 
+//  Evaluated arguments of a call. The caller owns the storage and keeps the
+//  values alive for the duration of the call (see ArgumentStack).
+using Arguments = std::span<Object* const>;
+
 class Function : public Object {
 public:
-    std::shared_ptr<Object> Eval(const std::shared_ptr<Scope>& scope) override;
+    Object* Eval(Scope* scope) override;
     void PrintObjectToOstream(std::ostream* out) override;
-    Function();
+    explicit Function(ObjectSubtype subtype = ObjectSubtype::NONE);
 
-    virtual std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                          const std::vector<std::shared_ptr<Object>>& arg) = 0;
+    virtual Object* Apply(Scope* scope, Arguments args) = 0;
 };
 
 class Syntax : public Object {
 public:
-    std::shared_ptr<Object> Eval(const std::shared_ptr<Scope>& scope) override;
+    Object* Eval(Scope* scope) override;
     void PrintObjectToOstream(std::ostream* out) override;
-    Syntax();
+    explicit Syntax(ObjectSubtype subtype = ObjectSubtype::NONE);
 
-    virtual std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                          const std::vector<std::shared_ptr<Object>>& arg) = 0;
+    //  Special forms are not applied to their arguments, but turn them into a node
+    virtual Node* Analyze(Arguments args, Analyzer* analyzer) = 0;
 };
 
-class Cell : public Object {
+//  A pair is just two words in a cell page of the heap, without a vtable or
+//  a header, so it is not an Object: values refer to pairs with tagged
+//  pointers (see MakeCell and AsCell).
+class Cell {
 public:
-    std::shared_ptr<Object> Eval(const std::shared_ptr<Scope>& scope) override;
-    void PrintObjectToOstream(std::ostream* out) override;
-    Cell(std::shared_ptr<Object> first, std::shared_ptr<Object> second);
-    std::shared_ptr<Object> GetFirst() const;
-    std::shared_ptr<Object> GetSecond() const;
-    void SetFirst(const std::shared_ptr<Object>& new_first);
-    void SetSecond(const std::shared_ptr<Object>& new_second);
+    Cell(Object* first, Object* second) : first_(first), second_(second) {
+    }
+
+    Object* Eval(Scope* scope);
+    void PrintObjectToOstream(std::ostream* out);
+
+    Object* GetFirst() const {
+        return first_;
+    }
+
+    Object* GetSecond() const {
+        return second_;
+    }
+
+    void SetFirst(Object* new_first) {
+        first_ = new_first;
+    }
+
+    void SetSecond(Object* new_second) {
+        second_ = new_second;
+    }
 
 private:
-    std::shared_ptr<Object> first_, second_;
+    Object* first_;
+    Object* second_;
 };
 
-void PrintTo(const std::shared_ptr<Object>& obj, std::ostream* out);
+static_assert(sizeof(Cell) == 2 * sizeof(Object*));
+
+/*************  Immediate values  *************/
+//  Integers which fit into 63 bits are not allocated on the heap: they are
+//  stored in the pointer itself with the lowest bit set (fixnums). Heap
+//  objects are aligned, so a real pointer never has this bit set.
+constexpr int64_t kFixnumMin = -(int64_t{1} << 62);
+constexpr int64_t kFixnumMax = (int64_t{1} << 62) - 1;
+
+inline bool IsFixnum(const Object* obj) {
+    return reinterpret_cast<uintptr_t>(obj) & kFixnumTag;
+}
+
+inline Object* MakeFixnum(int64_t value) {
+    return reinterpret_cast<Object*>((static_cast<uintptr_t>(value) << 1) | kFixnumTag);
+}
+
+inline int64_t GetFixnumValue(const Object* obj) {
+    return static_cast<int64_t>(reinterpret_cast<uintptr_t>(obj)) >> 1;
+}
+
+//  Returns a fixnum if the value fits, a boxed Number otherwise
+inline Object* MakeNumber(int64_t value) {
+    if (value >= kFixnumMin && value <= kFixnumMax) {
+        return MakeFixnum(value);
+    }
+    return Make<Number>(value);
+}
+
+//  Value of a fixnum or a boxed Number
+inline int64_t GetNumberValue(Object* obj) {
+    if (IsFixnum(obj)) {
+        return GetFixnumValue(obj);
+    }
+    return static_cast<Number*>(obj)->GetValue();
+}
+
+inline bool IsCell(const Object* obj) {
+    return (reinterpret_cast<uintptr_t>(obj) & kTagMask) == kCellTag;
+}
+
+//  Fixnums and pairs are not Objects in memory, so they have no vtable
+inline bool IsTagged(const Object* obj) {
+    return reinterpret_cast<uintptr_t>(obj) & kTagMask;
+}
+
+inline Object* ToObject(Cell* cell) {
+    return reinterpret_cast<Object*>(reinterpret_cast<uintptr_t>(cell) | kCellTag);
+}
+
+inline Object* MakeCell(Object* first, Object* second) {
+    auto& heap = Heap::Current();
+    auto cell = ToObject(new (heap.AllocateCell()) Cell(first, second));
+    heap.RegisterCell(cell);
+    return cell;
+}
+
+/*************  Type tests and downcasts  *************/
+//  Types are told apart by the pointer tag and the type stored in every
+//  object, without RTTI. The As* helpers expect the type to be checked.
+inline bool HasType(const Object* obj, ObjectType type) {
+    return obj && !IsTagged(obj) && obj->GetType() == type;
+}
+
+inline bool IsNumber(const Object* obj) {
+    return IsFixnum(obj) || HasType(obj, ObjectType::NUMBER);
+}
+
+inline bool IsSymbol(const Object* obj) {
+    return HasType(obj, ObjectType::SYMBOL);
+}
+
+inline bool IsString(const Object* obj) {
+    return HasType(obj, ObjectType::STRING);
+}
+
+inline bool IsFunction(const Object* obj) {
+    return HasType(obj, ObjectType::FUNCTION);
+}
+
+inline bool IsSyntax(const Object* obj) {
+    return HasType(obj, ObjectType::SYNTAX);
+}
+
+//  Numbers are either fixnums or boxed, so they are read through a view
+class NumberView {
+public:
+    explicit NumberView(int64_t value) : value_(value) {
+    }
+
+    int64_t GetValue() const {
+        return value_;
+    }
+
+    const NumberView* operator->() const {
+        return this;
+    }
+
+private:
+    int64_t value_;
+};
+
+inline NumberView AsNumber(Object* obj) {
+    assert(IsNumber(obj));
+    return NumberView(GetNumberValue(obj));
+}
+
+inline Cell* AsCell(Object* obj) {
+    assert(IsCell(obj));
+    return reinterpret_cast<Cell*>(reinterpret_cast<uintptr_t>(obj) & ~kTagMask);
+}
+
+inline Symbol* AsSymbol(Object* obj) {
+    assert(IsSymbol(obj));
+    return static_cast<Symbol*>(obj);
+}
+
+inline String* AsString(Object* obj) {
+    assert(IsString(obj));
+    return static_cast<String*>(obj);
+}
+
+inline Function* AsFunction(Object* obj) {
+    assert(IsFunction(obj));
+    return static_cast<Function*>(obj);
+}
+
+inline Syntax* AsSyntax(Object* obj) {
+    assert(IsSyntax(obj));
+    return static_cast<Syntax*>(obj);
+}
+
+//  Downcast to a final class, nullptr if the object has another type. The
+//  class names its subtype in kSubtype and passes it to the base class.
+template <class T>
+T* ExactCast(Object* obj) {
+    static_assert(std::is_final_v<T> && T::kSubtype != ObjectSubtype::NONE);
+    if (!obj || IsTagged(obj) || obj->GetSubtype() != T::kSubtype) {
+        return nullptr;
+    }
+    return static_cast<T*>(obj);
+}
+
+/*************  Lists  *************/
+//  Walks the elements of a chain of pairs without recursion. Iteration stops
+//  at the first tail which is not a pair: nullptr for a proper list, the
+//  last element of a dotted one.
+class ListIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Object*;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Object* const*;
+    using reference = Object*;
+
+    //  The end of any list
+    ListIterator() = default;
+
+    explicit ListIterator(Object* list) : rest_(list) {
+    }
+
+    Object* operator*() const {
+        return AsCell(rest_)->GetFirst();
+    }
+
+    ListIterator& operator++() {
+        rest_ = AsCell(rest_)->GetSecond();
+        return *this;
+    }
+
+    ListIterator operator++(int) {
+        auto previous = *this;
+        ++*this;
+        return previous;
+    }
+
+    bool operator==(const ListIterator& other) const {
+        return IsCell(rest_) ? rest_ == other.rest_ : !IsCell(other.rest_);
+    }
+
+    //  Part of the list which is not visited yet
+    Object* GetRest() const {
+        return rest_;
+    }
+
+private:
+    Object* rest_ = nullptr;
+};
+
+//  Elements of a list, for use in range-based for loops
+class ListRange {
+public:
+    explicit ListRange(Object* list) : list_(list) {
+    }
+
+    ListIterator begin() const {
+        return ListIterator(list_);
+    }
+
+    ListIterator end() const {
+        return ListIterator();
+    }
+
+private:
+    Object* list_;
+};
+
+//  Evaluate an object which may be an immediate value
+Object* EvalObject(Object* obj, Scope* scope);
+
+void PrintTo(Object* obj, std::ostream* out);
 
-std::vector<std::shared_ptr<Object>> ToVector(const std::shared_ptr<Object>& head);
+//  Elements of a list; the tail of a dotted list is the last element
+std::vector<Object*> ToVector(Object* head);
 
-bool IsNumber(const std::shared_ptr<Object>& obj);
-bool IsCell(const std::shared_ptr<Object>& obj);
-bool IsSymbol(const std::shared_ptr<Object>& obj);
 bool IsBracketClose(Token tok);
 bool IsDot(Token tok);
 
@@ -97,7 +368,7 @@ bool IsDot(Token tok);
 // <list>     :: () | (<expr> ... <expr) | (<expr> ... <expr> . <list>)
 
 //  Read an arbitrary expression
-std::shared_ptr<Object> Read(Tokenizer* tokenizer);
+Object* Read(Tokenizer* tokenizer);
 
 //  Read a list, a pair, or a list with a dot at the end
-std::shared_ptr<Object> ReadList(Tokenizer* tokenizer);
+Object* ReadList(Tokenizer* tokenizer);
@@ -1,15 +1,25 @@
 #include "printer.h"
 
-void PrintTo(const std::shared_ptr<Object>& obj, std::ostream* out) {
+void PrintTo(Object* obj, std::ostream* out) {
     if (!obj) {
         *out << "()";
         return;
     }
 
+    if (IsFixnum(obj)) {
+        *out << GetFixnumValue(obj);
+        return;
+    }
+
+    if (IsCell(obj)) {
+        AsCell(obj)->PrintObjectToOstream(out);
+        return;
+    }
+
     obj->PrintObjectToOstream(out);
 }
 
-std::string Print(const std::shared_ptr<Object>& obj) {
+std::string Print(Object* obj) {
     std::stringstream ss;
     PrintTo(obj, &ss);
     return ss.str();
@@ -6,6 +6,6 @@
 
 class Object;
 
-void PrintTo(const std::shared_ptr<Object>& obj, std::ostream* out);
+void PrintTo(Object* obj, std::ostream* out);
 
-std::string Print(const std::shared_ptr<Object>& obj);
+std::string Print(Object* obj);
@@ -5,7 +5,7 @@
 
 #include <parser.h>
 
-std::shared_ptr<Object> ReadFull(const std::string& str) {
+Handle<Object> ReadFull(const std::string& str) {
     std::stringstream ss{str};
     Tokenizer tokenizer{&ss};
 
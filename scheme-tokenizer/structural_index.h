@@ -0,0 +1,157 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*************  Character classes  *************/
+//  Spaces separate tokens; a symbol continues while characters are symbol
+//  tails (digits end a symbol and start a number).
+constexpr uint8_t kSpaceChar = 1;
+constexpr uint8_t kDigitChar = 2;
+constexpr uint8_t kSymbolTailChar = 4;
+
+constexpr std::array<uint8_t, 256> MakeCharClasses() {
+    std::array<uint8_t, 256> classes{};
+    for (int ch = 0; ch < 256; ++ch) {
+        if (ch == ' ' || ch == '\n' || ch == '\t' || ch == '\r') {
+            classes[ch] = kSpaceChar;
+        } else if (ch >= '0' && ch <= '9') {
+            classes[ch] = kDigitChar;
+        } else if (ch != '.' && ch != '\'' && ch != '(' && ch != ')' && ch != '"') {
+            classes[ch] = kSymbolTailChar;
+        }
+    }
+    return classes;
+}
+
+inline constexpr std::array<uint8_t, 256> kCharClasses = MakeCharClasses();
+
+//  EOF belongs to no class
+inline bool HasCharClass(int ch, uint8_t char_class) {
+    return ch >= 0 && (kCharClasses[ch] & char_class);
+}
+
+/*************  Structural index  *************/
+//  The input is classified a block at a time, like the first stage of
+//  simdjson: bit i of a mask is set if the i-th character of the block
+//  belongs to the class. Bits past the end of the input are always clear.
+constexpr size_t kBlockSize = 64;
+
+struct CharMasks {
+    uint64_t space = 0;
+    uint64_t digit = 0;
+    uint64_t symbol_tail = 0;
+    uint64_t open = 0;
+    uint64_t close = 0;
+    uint64_t quote = 0;
+    uint64_t string = 0;
+    uint64_t escape = 0;
+
+    //  Mask of one of the character classes above
+    uint64_t Of(uint8_t char_class) const {
+        return char_class == kSpaceChar ? space : char_class == kDigitChar ? digit : symbol_tail;
+    }
+};
+
+//  Up to kBlockSize characters, one at a time
+inline CharMasks ClassifyScalar(const char* data, size_t size) {
+    CharMasks masks;
+    for (size_t it = 0; it < size; ++it) {
+        auto ch = static_cast<unsigned char>(data[it]);
+        auto bit = uint64_t{1} << it;
+        auto char_class = kCharClasses[ch];
+        masks.space |= (char_class & kSpaceChar) ? bit : 0;
+        masks.digit |= (char_class & kDigitChar) ? bit : 0;
+        masks.symbol_tail |= (char_class & kSymbolTailChar) ? bit : 0;
+        masks.open |= ch == '(' ? bit : 0;
+        masks.close |= ch == ')' ? bit : 0;
+        masks.quote |= ch == '\'' ? bit : 0;
+        masks.string |= ch == '"' ? bit : 0;
+        masks.escape |= ch == '\\' ? bit : 0;
+    }
+    return masks;
+}
+
+//  Exactly kBlockSize characters, 32 or 16 at a time where AVX2 or SSE2 is
+//  enabled at compile time
+inline CharMasks ClassifyBlock(const char* data) {
+#if defined(__AVX2__)
+    CharMasks masks;
+    for (size_t part = 0; part < kBlockSize; part += 32) {
+        auto chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + part));
+        auto equal = [chars](char ch) { return _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(ch)); };
+        auto to_mask = [part](__m256i bytes) {
+            return uint64_t{static_cast<uint32_t>(_mm256_movemask_epi8(bytes))} << part;
+        };
+
+        auto space = _mm256_or_si256(_mm256_or_si256(equal(' '), equal('\n')),
+                                     _mm256_or_si256(equal('\t'), equal('\r')));
+        //  Bytes above 127 are negative, so they are not digits
+        auto digit = _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('0' - 1)),
+                                      _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), chars));
+        auto open = equal('(');
+        auto close = equal(')');
+        auto quote = equal('\'');
+        auto string = equal('"');
+        auto other = _mm256_or_si256(
+            _mm256_or_si256(_mm256_or_si256(space, digit), _mm256_or_si256(open, close)),
+            _mm256_or_si256(_mm256_or_si256(quote, string), equal('.')));
+
+        masks.space |= to_mask(space);
+        masks.digit |= to_mask(digit);
+        masks.symbol_tail |= to_mask(_mm256_xor_si256(other, _mm256_set1_epi8(-1)));
+        masks.open |= to_mask(open);
+        masks.close |= to_mask(close);
+        masks.quote |= to_mask(quote);
+        masks.string |= to_mask(string);
+        masks.escape |= to_mask(equal('\\'));
+    }
+    return masks;
+#elif defined(__SSE2__)
+    CharMasks masks;
+    for (size_t part = 0; part < kBlockSize; part += 16) {
+        auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + part));
+        auto equal = [chars](char ch) { return _mm_cmpeq_epi8(chars, _mm_set1_epi8(ch)); };
+        auto to_mask = [part](__m128i bytes) {
+            return uint64_t{static_cast<uint32_t>(_mm_movemask_epi8(bytes))} << part;
+        };
+
+        auto space =
+            _mm_or_si128(_mm_or_si128(equal(' '), equal('\n')), _mm_or_si128(equal('\t'), equal('\r')));
+        //  Bytes above 127 are negative, so they are not digits
+        auto digit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+                                   _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+        auto open = equal('(');
+        auto close = equal(')');
+        auto quote = equal('\'');
+        auto string = equal('"');
+        auto other =
+            _mm_or_si128(_mm_or_si128(_mm_or_si128(space, digit), _mm_or_si128(open, close)),
+                         _mm_or_si128(_mm_or_si128(quote, string), equal('.')));
+
+        masks.space |= to_mask(space);
+        masks.digit |= to_mask(digit);
+        masks.symbol_tail |= to_mask(_mm_xor_si128(other, _mm_set1_epi8(-1)));
+        masks.open |= to_mask(open);
+        masks.close |= to_mask(close);
+        masks.quote |= to_mask(quote);
+        masks.string |= to_mask(string);
+        masks.escape |= to_mask(equal('\\'));
+    }
+    return masks;
+#else
+    return ClassifyScalar(data, kBlockSize);
+#endif
+}
+
+//  Up to kBlockSize characters
+inline CharMasks Classify(const char* data, size_t size) {
+    return size >= kBlockSize ? ClassifyBlock(data) : ClassifyScalar(data, size);
+}
@@ -1,65 +1,108 @@
 #include "scheme.h"
 
-Scheme::Scheme() : global_scope_(std::make_shared<Scope>()) {
+#include <fstream>
+
+#include "fasl.h"
+#include "mapped_file.h"
+
+namespace {
+
+//  (load "path") evaluates a file in the global scope
+class LoadFunction : public Function {
+public:
+    explicit LoadFunction(Scheme* scheme) : scheme_(scheme) {
+    }
+
+    Object* Apply(Scope*, Arguments args) override {
+        if (args.size() != 1 || !IsString(args[0])) {
+            throw RuntimeError("load: a file name expected");
+        }
+        return scheme_->LoadFile(AsString(args[0])->GetValue());
+    }
+
+private:
+    Scheme* scheme_;
+};
+
+//  A proper, non-empty list of numbers is data, not a call
+bool IsListOfNumbers(Object* value) {
+    ListIterator it(value);
+    for (; it != ListIterator(); ++it) {
+        if (!IsNumber(*it)) {
+            return false;
+        }
+    }
+    return IsCell(value) && it.GetRest() == nullptr;
+}
+
+}  // namespace
+
+Scheme::Scheme(Engine engine) : global_scope_(Make<Scope>()) {
     /*************  Symbols  *************/
-    global_scope_->Insert("#t", std::make_shared<True>());
-    global_scope_->Insert("#f", std::make_shared<False>());
+    global_scope_->Insert(Intern("#t"), True::Instance());
+    global_scope_->Insert(Intern("#f"), False::Instance());
 
     /*************  Syntax  *************/
-    global_scope_->Insert("if", std::make_shared<IfSynt>());
-    global_scope_->Insert("quote", std::make_shared<QuoteSynt>());
-    global_scope_->Insert("lambda", std::make_shared<LambdaSynt>());
-    global_scope_->Insert("and", std::make_shared<AndSynt>());
-    global_scope_->Insert("or", std::make_shared<OrSynt>());
-    global_scope_->Insert("define", std::make_shared<DefineSynt>());
-    global_scope_->Insert("set!", std::make_shared<SetSynt>());
-    global_scope_->Insert("eval", std::make_shared<EvalSynt>());
+    global_scope_->Insert(Intern("if"), Make<IfSynt>());
+    global_scope_->Insert(Intern("quote"), Make<QuoteSynt>());
+    global_scope_->Insert(Intern("lambda"), Make<LambdaSynt>());
+    global_scope_->Insert(Intern("and"), Make<AndSynt>());
+    global_scope_->Insert(Intern("or"), Make<OrSynt>());
+    global_scope_->Insert(Intern("define"), Make<DefineSynt>());
+    global_scope_->Insert(Intern("set!"), Make<SetSynt>());
+    global_scope_->Insert(Intern("eval"), Make<EvalSynt>());
 
     /*************  Predicates  *************/
-    global_scope_->Insert("null?", std::make_shared<IsNullPred>());
-    global_scope_->Insert("pair?", std::make_shared<IsPairPred>());
-    global_scope_->Insert("number?", std::make_shared<IsNumberPred>());
-    global_scope_->Insert("boolean?", std::make_shared<IsBooleanPred>());
-    global_scope_->Insert("symbol?", std::make_shared<IsSymbolPred>());
-    global_scope_->Insert("list?", std::make_shared<IsListPred>());
-    global_scope_->Insert("eq?", std::make_shared<IsEqualPred>());
-    global_scope_->Insert("equal?", std::make_shared<IsEqualPred>());
-    global_scope_->Insert("integer-equal?", std::make_shared<IsIntegerEqualPred>());
+    global_scope_->Insert(Intern("null?"), Make<IsNullPred>());
+    global_scope_->Insert(Intern("pair?"), Make<IsPairPred>());
+    global_scope_->Insert(Intern("number?"), Make<IsNumberPred>());
+    global_scope_->Insert(Intern("boolean?"), Make<IsBooleanPred>());
+    global_scope_->Insert(Intern("symbol?"), Make<IsSymbolPred>());
+    global_scope_->Insert(Intern("list?"), Make<IsListPred>());
+    global_scope_->Insert(Intern("eq?"), Make<IsEqualPred>());
+    global_scope_->Insert(Intern("equal?"), Make<IsEqualPred>());
+    global_scope_->Insert(Intern("integer-equal?"), Make<IsIntegerEqualPred>());
 
     /*************  Logical Operators  *************/
-    global_scope_->Insert("not", std::make_shared<LogicalNegation>());
+    global_scope_->Insert(Intern("not"), Make<LogicalNegation>());
 
     /*************  Integer Functions  *************/
-    global_scope_->Insert("+", std::make_shared<AddInt>());
-    global_scope_->Insert("-", std::make_shared<SubtractInt>());
-    global_scope_->Insert("*", std::make_shared<MultiplyInt>());
-    global_scope_->Insert("/", std::make_shared<DivideInt>());
+    global_scope_->Insert(Intern("+"), Make<AddInt>());
+    global_scope_->Insert(Intern("-"), Make<SubtractInt>());
+    global_scope_->Insert(Intern("*"), Make<MultiplyInt>());
+    global_scope_->Insert(Intern("/"), Make<DivideInt>());
 
-    global_scope_->Insert("=", std::make_shared<EqualInt>());
-    global_scope_->Insert(">", std::make_shared<GreaterInt>());
-    global_scope_->Insert("<", std::make_shared<LessInt>());
-    global_scope_->Insert(">=", std::make_shared<GreaterEqualInt>());
-    global_scope_->Insert("<=", std::make_shared<LessEqualInt>());
+    global_scope_->Insert(Intern("="), Make<EqualInt>());
+    global_scope_->Insert(Intern(">"), Make<GreaterInt>());
+    global_scope_->Insert(Intern("<"), Make<LessInt>());
+    global_scope_->Insert(Intern(">="), Make<GreaterEqualInt>());
+    global_scope_->Insert(Intern("<="), Make<LessEqualInt>());
 
-    global_scope_->Insert("min", std::make_shared<MinInt>());
-    global_scope_->Insert("max", std::make_shared<MaxInt>());
-    global_scope_->Insert("abs", std::make_shared<AbsInt>());
+    global_scope_->Insert(Intern("min"), Make<MinInt>());
+    global_scope_->Insert(Intern("max"), Make<MaxInt>());
+    global_scope_->Insert(Intern("abs"), Make<AbsInt>());
 
     /*************  List Functions  *************/
-    global_scope_->Insert("cons", std::make_shared<ConsList>());
-    global_scope_->Insert("car", std::make_shared<CarList>());
-    global_scope_->Insert("cdr", std::make_shared<CdrList>());
-    global_scope_->Insert("set-car!", std::make_shared<SetCarList>());
-    global_scope_->Insert("set-cdr!", std::make_shared<SetCdrList>());
-    global_scope_->Insert("list", std::make_shared<ListList>());
-    global_scope_->Insert("list-ref", std::make_shared<ListRefList>());
-    global_scope_->Insert("list-tail", std::make_shared<ListTailList>());
+    global_scope_->Insert(Intern("cons"), Make<ConsList>());
+    global_scope_->Insert(Intern("car"), Make<CarList>());
+    global_scope_->Insert(Intern("cdr"), Make<CdrList>());
+    global_scope_->Insert(Intern("set-car!"), Make<SetCarList>());
+    global_scope_->Insert(Intern("set-cdr!"), Make<SetCdrList>());
+    global_scope_->Insert(Intern("list"), Make<ListList>());
+    global_scope_->Insert(Intern("list-ref"), Make<ListRefList>());
+    global_scope_->Insert(Intern("list-tail"), Make<ListTailList>());
+
+    /*************  Files  *************/
+    global_scope_->Insert(Intern("load"), Make<LoadFunction>(this));
+
+    if (engine == Engine::BYTECODE) {
+        vm_ = std::make_unique<VirtualMachine>(global_scope_);
+    }
 }
 
-std::shared_ptr<Object> Scheme::ReadCommand(const std::string& str) {
-    std::stringstream ss{str};
-    Tokenizer tokenizer{&ss};
-    auto result = Read(&tokenizer);
+Handle<Object> Scheme::ReadCommand(const std::string& str) {
+    Tokenizer tokenizer{std::string_view(str)};
+    Handle<Object> result = Read(&tokenizer);
     if (!tokenizer.IsEnd()) {
         throw SyntaxError("tokenizer: end of tokenizer expected");
     } else {
@@ -67,21 +110,84 @@ std::shared_ptr<Object> Scheme::ReadCommand(const std::string& str) {
     }
 }
 
-std::shared_ptr<Object> Scheme::Eval(const std::shared_ptr<Object>& in) {
+Handle<Object> Scheme::Eval(Object* in) {
     if (!in) {
         throw RuntimeError("scheme: no objects to evaluate");
     } else {
-        std::vector<std::shared_ptr<Object>> in_as_vector{in};
-        IsListPred is_list;
-        auto check_list = is_list.Apply(global_scope_, in_as_vector);
-        if (std::dynamic_pointer_cast<True>(check_list)) {
+        if (IsListOfNumbers(in)) {
             throw RuntimeError("scheme: lists are not self-evaluating");
+        }
+
+        //  The machine does not call lambdas on the C++ stack, but analyzes
+        //  and compiles nested forms there
+        StackLimit limit(stack_budget_);
+        if (vm_) {
+            return vm_->Execute(in);
         } else {
-            return in->Eval(global_scope_);
+            return EvalObject(in, global_scope_);
         }
     }
 }
 
+void Scheme::ReadForms(std::istream* in, const FormCallback& callback) {
+    Tokenizer tokenizer{in};
+    ReadForms(&tokenizer, callback);
+}
+
+void Scheme::ReadForms(std::string_view input, const FormCallback& callback) {
+    Tokenizer tokenizer{input};
+    ReadForms(&tokenizer, callback);
+}
+
+void Scheme::ReadForms(Tokenizer* tokenizer, const FormCallback& callback) {
+    while (!tokenizer->IsEnd()) {
+        Handle<Object> form = Read(tokenizer);
+        callback(form);
+    }
+}
+
+Handle<Object> Scheme::LoadFile(const std::string& path) {
+    MappedFile file(path);
+    Handle<Object> result;
+    if (IsFasl(file.GetContents())) {
+        for (auto form : ReadFasl(file.GetContents())) {
+            result = Eval(form);
+        }
+        return result;
+    }
+    ReadForms(file.GetContents(), [this, &result](Object* form) { result = Eval(form); });
+    return result;
+}
+
+void Scheme::CompileFile(const std::string& source, const std::string& target) {
+    RootedVector<Object> forms;
+    {
+        MappedFile file(source);
+        ReadForms(file.GetContents(), [&forms](Object* form) { forms.push_back(form); });
+    }
+
+    auto data = WriteFasl(static_cast<const std::vector<Object*>&>(forms));
+    std::ofstream out(target, std::ios::binary);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    out.close();
+    if (!out) {
+        throw RuntimeError("compile: cannot write " + target);
+    }
+}
+
+HeapStats Scheme::GetHeapStats() const {
+    return Heap::Current().GetStats();
+}
+
+void Scheme::SetStackBudget(size_t bytes) {
+    stack_budget_ = bytes;
+    if (vm_) {
+        vm_->SetStackBudget(bytes);
+    }
+}
+
 Scheme::~Scheme() {
-    global_scope_->Clear();  // TODO create proper garbage collector
+    vm_ = nullptr;
+    global_scope_ = nullptr;
+    Heap::Current().Collect();
 }
@@ -1,21 +1,58 @@
 #pragma once
 
+#include <functional>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+
 #include <tokenizer.h>
 #include <parser.h>
 #include <functions.h>
 #include <syntax.h>
 #include <symbols.h>
+#include <vm.h>
+#include "heap.h"
 #include "scope.h"
 #include "errors.h"
 #include "printer.h"
 
+//  Tree-walking evaluation of analyzed forms, or compilation to bytecode
+//  executed by a stack machine
+enum class Engine { TREE_WALKER, BYTECODE };
+
+//  Receives a top-level form, which stays rooted for the duration of the call
+using FormCallback = std::function<void(Object*)>;
+
 class Scheme {
 public:
-    Scheme();
-    std::shared_ptr<Object> ReadCommand(const std::string& str);
-    std::shared_ptr<Object> Eval(const std::shared_ptr<Object>& in);
+    explicit Scheme(Engine engine = Engine::TREE_WALKER);
+    Handle<Object> ReadCommand(const std::string& str);
+    Handle<Object> Eval(Object* in);
+    //  Read the top-level forms of the input one at a time, in order. A form
+    //  is dropped once the callback returns, and the stream is consumed in
+    //  chunks, so input of any size is read in constant memory.
+    void ReadForms(std::istream* in, const FormCallback& callback);
+    void ReadForms(std::string_view input, const FormCallback& callback);
+    //  Evaluates the top-level forms of a file in order and returns the value
+    //  of the last one. The file is mapped into memory and read in place;
+    //  it holds either source text or forms written by CompileFile.
+    Handle<Object> LoadFile(const std::string& path);
+    //  Stores the forms of a source file in the binary form (see fasl.h),
+    //  which loads faster than text
+    void CompileFile(const std::string& source, const std::string& target);
+    HeapStats GetHeapStats() const;
+    //  Limits the depth of recursion: the bytecode engine keeps pending calls
+    //  off the C++ stack and limits the size of its own stack, the tree
+    //  walker limits the C++ stack it takes, and never takes more than the
+    //  stack of the thread. Deeper recursion raises RuntimeError.
+    void SetStackBudget(size_t bytes);
     ~Scheme();
 
 private:
-    std::shared_ptr<Scope> global_scope_;
+    void ReadForms(Tokenizer* tokenizer, const FormCallback& callback);
+
+    Handle<Scope> global_scope_;
+    std::unique_ptr<VirtualMachine> vm_;
+    size_t stack_budget_ = VirtualMachine::kDefaultStackBudget;
 };
@@ -0,0 +1,356 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <heap.h>
+#include <parser.h>
+#include <scope.h>
+
+class ConstantNode;
+class VariableNode;
+class LocalVariableNode;
+class IfNode;
+class AndNode;
+class OrNode;
+class DefineNode;
+class SetNode;
+class LocalSetNode;
+class LambdaNode;
+class CallNode;
+class EvalNode;
+class LambdaClosure;
+
+//  Lets other back ends (the bytecode compiler) walk analyzed code
+class NodeVisitor {
+public:
+    virtual ~NodeVisitor() = default;
+    virtual void Visit(ConstantNode* node) = 0;
+    virtual void Visit(VariableNode* node) = 0;
+    virtual void Visit(LocalVariableNode* node) = 0;
+    virtual void Visit(IfNode* node) = 0;
+    virtual void Visit(AndNode* node) = 0;
+    virtual void Visit(OrNode* node) = 0;
+    virtual void Visit(DefineNode* node) = 0;
+    virtual void Visit(SetNode* node) = 0;
+    virtual void Visit(LocalSetNode* node) = 0;
+    virtual void Visit(LambdaNode* node) = 0;
+    virtual void Visit(CallNode* node) = 0;
+    virtual void Visit(EvalNode* node) = 0;
+};
+
+//  Forms are analyzed once into a tree of nodes, which is then executed
+//  without looking at the list structure again. Nodes run in the frame of
+//  the innermost enclosing lambda, top-level code runs without a frame.
+class Node : public HeapObject {
+public:
+    virtual Object* Execute(Environment* environment) = 0;
+    virtual void Accept(NodeVisitor* visitor) = 0;
+
+    //  Called on the last expression of a lambda body
+    virtual void MarkTailPosition();
+};
+
+class ConstantNode : public Node {
+public:
+    explicit ConstantNode(Object* value);
+    Object* Execute(Environment* environment) override;
+    void Accept(NodeVisitor* visitor) override;
+    void Trace(Tracer* tracer) override;
+    Object* GetValue() const;
+
+private:
+    Object* value_;
+};
+
+//  A global variable
+class VariableNode : public Node {
+public:
+    VariableNode(Scope* scope, Symbol* name);
+    Object* Execute(Environment* environment) override;
+    void Accept(NodeVisitor* visitor) override;
+    void Trace(Tracer* tracer) override;
+    Symbol* GetName() const;
+
+private:
+    Scope* scope_;
+    Symbol* name_;
+};
+
+//  A variable of an enclosing lambda
+class LocalVariableNode : public Node {
+public:
+    LocalVariableNode(size_t depth, size_t slot);
+    Object* Execute(Environment* environment) override;
+    void Accept(NodeVisitor* visitor) override;
+    size_t GetDepth() const;
+    size_t GetSlot() const;
+
+private:
+    size_t depth_;
+    size_t slot_;
+};
+
+class IfNode : public Node {
+public:
+    IfNode(Node* condition, Node* true_branch, Node* false_branch);
+    Object* Execute(Environment* environment) override;
+    void Accept(NodeVisitor* visitor) override;
+    void Trace(Tracer* tracer) override;
+    void MarkTailPosition() override;
+    Node* GetCondition() const;
+    Node* GetTrueBranch() const;
+    Node* GetFalseBranch() const;
+
+private:
+    Node* condition_;
+    Node* true_branch_;
+    Node* false_branch_;
+};
+
+class AndNode : public Node {
+public:
+    explicit AndNode(const std::vector<Node*>& arguments);
+    Object* Execute(Environment* environment) override;
+    void Accept(NodeVisitor* visitor) override;
+    void Trace(Tracer* tracer) override;
+    void MarkTailPosition() override;
+    const std::vector<Node*>& GetArguments() const;
+
+private:
+    std::vector<Node*> arguments_;
+};
+
+class OrNode : public Node {
+public:
+    explicit OrNode(const std::vector<Node*>& arguments);
+    Object* Execute(Environment* environment) override;
+    void Accept(NodeVisitor* visitor) override;
+    void Trace(Tracer* tracer) override;
+    void MarkTailPosition() override;
+    const std::vector<Node*>& GetArguments() const;
+
+private:
+    std::vector<Node*> arguments_;
+};
+
+//  Definition of a global
+class DefineNode : public Node {
+public:
+    DefineNode(Scope* scope, Symbol* name, Node* value);
+    Object* Execute(Environment* environment) override;
+    void Accept(NodeVisitor* visitor) override;
+    void Trace(Tracer* tracer) override;
+    Symbol* GetName() const;
+    Node* GetValue() const;
+
+private:
+    Scope* scope_;
+    Symbol* name_;
+    Node* value_;
+};
+
+//  set! of a global
+class SetNode : public Node {
+public:
+    SetNode(Scope* scope, Symbol* name, Node* value);
+    Object* Execute(Environment* environment) override;
+    void Accept(NodeVisitor* visitor) override;
+    void Trace(Tracer* tracer) override;
+    Symbol* GetName() const;
+    Node* GetValue() const;
+
+private:
+    Scope* scope_;
+    Symbol* name_;
+    Node* value_;
+};
+
+//  Definition or set! of a local variable
+class LocalSetNode : public Node {
+public:
+    LocalSetNode(size_t depth, size_t slot, Node* value);
+    Object* Execute(Environment* environment) override;
+    void Accept(NodeVisitor* visitor) override;
+    void Trace(Tracer* tracer) override;
+    size_t GetDepth() const;
+    size_t GetSlot() const;
+    Node* GetValue() const;
+
+private:
+    size_t depth_;
+    size_t slot_;
+    Node* value_;
+};
+
+class LambdaNode : public Node {
+public:
+    LambdaNode(size_t arity, size_t frame_size, const std::vector<Node*>& body);
+    Object* Execute(Environment* environment) override;
+    void Accept(NodeVisitor* visitor) override;
+    void Trace(Tracer* tracer) override;
+    size_t GetArity() const;
+    size_t GetFrameSize() const;
+    const std::vector<Node*>& GetBody() const;
+
+private:
+    size_t arity_;
+    size_t frame_size_;
+    std::vector<Node*> body_;
+};
+
+class CallNode : public Node {
+public:
+    CallNode(Scope* scope, Cell* form, Node* function, const std::vector<Node*>& arguments);
+    Object* Execute(Environment* environment) override;
+    void Accept(NodeVisitor* visitor) override;
+    void Trace(Tracer* tracer) override;
+    void MarkTailPosition() override;
+    Node* GetFunction() const;
+    const std::vector<Node*>& GetArguments() const;
+
+private:
+    Scope* scope_;
+    //  Kept for syntax objects which are only known at run time
+    Cell* form_;
+    Node* function_;
+    std::vector<Node*> arguments_;
+    bool tail_ = false;
+};
+
+class EvalNode : public Node {
+public:
+    EvalNode(Scope* scope, Node* argument);
+    Object* Execute(Environment* environment) override;
+    void Accept(NodeVisitor* visitor) override;
+    void Trace(Tracer* tracer) override;
+    Node* GetArgument() const;
+
+private:
+    Scope* scope_;
+    Node* argument_;
+};
+
+//  Calls of lambdas in tail position do not recurse: the call is stored
+//  here and a marker is returned to the closure being applied, which
+//  makes the call in a loop.
+class TailCall : public RootBase {
+public:
+    static TailCall& Current();
+    static Object* Marker();
+
+    //  Returns the marker
+    Object* Schedule(LambdaClosure* closure, Arguments args);
+    LambdaClosure* GetClosure() const;
+    Arguments GetArguments() const;
+    //  Keeps the capacity, so scheduling does not allocate in a loop
+    void Clear();
+
+private:
+    void Trace(Tracer* tracer) override;
+
+    LambdaClosure* closure_ = nullptr;
+    std::vector<Object*> args_;
+};
+
+//  Calls of lambdas which are not in tail position recurse on the C++
+//  stack, and so do analysis, compilation and execution of nested forms.
+//  While a limit is set, each of them raises RuntimeError past it instead
+//  of overflowing the stack. The limit is the given budget below the frame
+//  which sets it, and never lower than the end of the stack of the thread
+//  minus a reserve for primitives. Nested limits only tighten it.
+class StackLimit {
+public:
+    explicit StackLimit(size_t budget);
+    StackLimit(const StackLimit&) = delete;
+    StackLimit& operator=(const StackLimit&) = delete;
+    ~StackLimit();
+
+    //  Throws if the frame of the caller is past the limit
+    static void Check();
+
+private:
+    static constexpr size_t kReserve = 256 << 10;
+
+    static inline thread_local uintptr_t limit_ = 0;
+    uintptr_t previous_;
+};
+
+//  Evaluated arguments of the calls in progress. A call takes a window of
+//  the stack for its arguments and passes it to Apply as a span, so calls
+//  do not allocate. Values are kept in chunks which are never moved, so a
+//  window stays valid while nested calls take their own windows.
+class ArgumentStack : public RootBase {
+public:
+    static ArgumentStack& Current();
+
+private:
+    friend class ArgumentWindow;
+
+    static constexpr size_t kChunkSize = 4096;
+
+    struct Chunk {
+        std::unique_ptr<Object*[]> values;
+        size_t capacity;
+        size_t top;
+    };
+
+    void Trace(Tracer* tracer) override;
+
+    std::vector<Chunk> chunks_;
+    size_t current_ = 0;
+};
+
+//  Arguments of a single call, released in reverse order of creation
+class ArgumentWindow {
+public:
+    //  All values are nullptr
+    explicit ArgumentWindow(size_t size);
+    explicit ArgumentWindow(Arguments values);
+    ArgumentWindow(const ArgumentWindow&) = delete;
+    ArgumentWindow& operator=(const ArgumentWindow&) = delete;
+    ~ArgumentWindow();
+
+    Object*& operator[](size_t index) {
+        return values_[index];
+    }
+
+    operator Arguments() const {
+        return {values_, size_};
+    }
+
+private:
+    ArgumentStack& stack_;
+    size_t previous_chunk_;
+    Object** values_;
+    size_t size_;
+};
+
+//  Turns forms into nodes. Special forms are recognized by looking up the
+//  head symbol in the scope of the analyzed code: if it names a Syntax
+//  object, the syntax builds the node itself. Variables of lambdas are
+//  resolved to frame coordinates, all other variables are globals.
+class Analyzer {
+public:
+    explicit Analyzer(Scope* scope);
+
+    Node* Analyze(Object* form);
+    RootedVector<Node> AnalyzeAll(Arguments forms);
+    Scope* GetScope() const;
+
+    //  Every lambda body gets its own frame, parameters take the first slots
+    void PushFrame(const std::vector<Symbol*>& variables);
+    //  Returns the number of slots of the frame
+    size_t PopFrame();
+    bool IsTopLevel() const;
+    size_t DeclareLocal(Symbol* name);
+    bool Resolve(Symbol* name, size_t* depth, size_t* slot) const;
+    Syntax* LookupSyntax(Object* head) const;
+
+private:
+
+    Scope* scope_;
+    std::vector<std::vector<Symbol*>> frames_;
+};
@@ -0,0 +1,190 @@
+#include "bytecode.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <symbols.h>
+
+void CodeObject::Trace(Tracer* tracer) {
+    for (auto& constant : constants) {
+        tracer->Visit(constant);
+    }
+    for (auto& function : functions) {
+        tracer->Visit(function);
+    }
+}
+
+Compiler::Compiler(Scope* global_scope) : global_scope_(global_scope) {
+}
+
+CodeObject* Compiler::Compile(Object* form) {
+    Analyzer analyzer(global_scope_);
+    Handle<Node> node = analyzer.Analyze(form);
+
+    auto code = Make<CodeObject>();
+    code_objects_.push_back(code);
+    functions_.push_back(code);
+    CompileNode(node, true);
+    Emit(Opcode::RETURN);
+    functions_.pop_back();
+
+    return code;
+}
+
+void Compiler::Visit(ConstantNode* node) {
+    Emit(Opcode::CONSTANT, AddConstant(node->GetValue()));
+}
+
+void Compiler::Visit(VariableNode* node) {
+    Emit(Opcode::LOAD_GLOBAL, AddConstant(node->GetName()));
+}
+
+void Compiler::Visit(LocalVariableNode* node) {
+    if (node->GetDepth() == 0) {
+        Emit(Opcode::LOAD_LOCAL, node->GetSlot());
+    } else {
+        Emit(Opcode::LOAD_CLOSURE, node->GetSlot(), node->GetDepth());
+    }
+}
+
+void Compiler::Visit(IfNode* node) {
+    bool tail = tail_;
+
+    CompileNode(node->GetCondition(), false);
+    auto to_false_branch = EmitJump(Opcode::JUMP_IF_FALSE);
+    CompileNode(node->GetTrueBranch(), tail);
+    auto to_end = EmitJump(Opcode::JUMP);
+
+    PatchJump(to_false_branch);
+    if (node->GetFalseBranch()) {
+        CompileNode(node->GetFalseBranch(), tail);
+    } else {
+        Emit(Opcode::CONSTANT, AddConstant(nullptr));
+    }
+    PatchJump(to_end);
+}
+
+void Compiler::Visit(AndNode* node) {
+    CompileLogical(node->GetArguments(), Opcode::JUMP_IF_FALSE_OR_POP, True::Instance());
+}
+
+void Compiler::Visit(OrNode* node) {
+    CompileLogical(node->GetArguments(), Opcode::JUMP_IF_TRUE_OR_POP, False::Instance());
+}
+
+void Compiler::Visit(DefineNode* node) {
+    CompileNode(node->GetValue(), false);
+    Emit(Opcode::DEFINE_GLOBAL, AddConstant(node->GetName()));
+}
+
+void Compiler::Visit(SetNode* node) {
+    CompileNode(node->GetValue(), false);
+    Emit(Opcode::SET_GLOBAL, AddConstant(node->GetName()));
+}
+
+void Compiler::Visit(LocalSetNode* node) {
+    CompileNode(node->GetValue(), false);
+    if (node->GetDepth() == 0) {
+        Emit(Opcode::STORE_LOCAL, node->GetSlot());
+    } else {
+        Emit(Opcode::STORE_CLOSURE, node->GetSlot(), node->GetDepth());
+    }
+}
+
+void Compiler::Visit(LambdaNode* node) {
+    auto code = Make<CodeObject>();
+    code_objects_.push_back(code);
+    code->arity = node->GetArity();
+    code->frame_size = node->GetFrameSize();
+    functions_.push_back(code);
+
+    auto& body = node->GetBody();
+    for (size_t it = 0; it < body.size(); ++it) {
+        bool last = it + 1 == body.size();
+        CompileNode(body[it], last);
+        if (!last) {
+            Emit(Opcode::POP);
+        }
+    }
+    Emit(Opcode::RETURN);
+    functions_.pop_back();
+
+    auto& parent = functions_.back()->functions;
+    parent.push_back(code);
+    Emit(Opcode::MAKE_CLOSURE, parent.size() - 1);
+}
+
+void Compiler::Visit(CallNode* node) {
+    bool tail = tail_;
+
+    CompileNode(node->GetFunction(), false);
+    for (auto& arg : node->GetArguments()) {
+        CompileNode(arg, false);
+    }
+    Emit(tail ? Opcode::TAIL_CALL : Opcode::CALL, node->GetArguments().size());
+}
+
+void Compiler::Visit(EvalNode* node) {
+    CompileNode(node->GetArgument(), false);
+    Emit(Opcode::EVAL);
+}
+
+void Compiler::CompileNode(Node* node, bool tail) {
+    StackLimit::Check();
+    bool saved = tail_;
+    tail_ = tail;
+    node->Accept(this);
+    tail_ = saved;
+}
+
+void Compiler::CompileLogical(const std::vector<Node*>& arguments, Opcode jump, Object* empty) {
+    if (arguments.empty()) {
+        Emit(Opcode::CONSTANT, AddConstant(empty));
+        return;
+    }
+
+    bool tail = tail_;
+    std::vector<size_t> to_end;
+    for (size_t it = 0; it < arguments.size(); ++it) {
+        bool last = it + 1 == arguments.size();
+        CompileNode(arguments[it], tail && last);
+        if (!last) {
+            to_end.push_back(EmitJump(jump));
+        }
+    }
+
+    for (auto& position : to_end) {
+        PatchJump(position);
+    }
+}
+
+void Compiler::Emit(Opcode opcode, size_t operand, size_t depth) {
+    if (operand > std::numeric_limits<uint32_t>::max()) {
+        throw SyntaxError("compile: too many constants or instructions");
+    }
+    if (depth > std::numeric_limits<uint16_t>::max()) {
+        throw SyntaxError("compile: lambdas are nested too deeply");
+    }
+    functions_.back()->code.push_back(
+        {opcode, static_cast<uint16_t>(depth), static_cast<uint32_t>(operand)});
+}
+
+size_t Compiler::EmitJump(Opcode opcode) {
+    Emit(opcode);
+    return functions_.back()->code.size() - 1;
+}
+
+void Compiler::PatchJump(size_t position) {
+    auto& code = functions_.back()->code;
+    code[position].operand = code.size();
+}
+
+size_t Compiler::AddConstant(Object* value) {
+    auto& constants = functions_.back()->constants;
+    auto it = std::find(constants.begin(), constants.end(), value);
+    if (it != constants.end()) {
+        return it - constants.begin();
+    }
+    constants.push_back(value);
+    return constants.size() - 1;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <analyzer.h>
+#include <heap.h>
+#include <parser.h>
+#include <scope.h>
+
+enum class Opcode : uint8_t {
+    CONSTANT,       //  push constants[operand]
+    LOAD_LOCAL,     //  push slot operand of the current frame
+    LOAD_CLOSURE,   //  push slot operand of the frame depth levels up
+    LOAD_GLOBAL,    //  push global named by constants[operand]
+    STORE_LOCAL,    //  store top of stack in a slot, keep it on the stack
+    STORE_CLOSURE,  //  store top of stack in a slot depth levels up, keep it
+    SET_GLOBAL,     //  set! an existing global
+    DEFINE_GLOBAL,  //  define a global
+    POP,
+    JUMP,                  //  continue at operand
+    JUMP_IF_FALSE,         //  pop, jump if the value is #f or ()
+    JUMP_IF_FALSE_OR_POP,  //  jump keeping the value if it is #f, pop otherwise
+    JUMP_IF_TRUE_OR_POP,   //  jump keeping the value unless it is #f, pop otherwise
+    MAKE_CLOSURE,          //  push a closure over functions[operand]
+    CALL,                  //  call with operand arguments
+    TAIL_CALL,             //  call replacing the current frame
+    RETURN,
+    EVAL,  //  evaluate the value on top of the stack
+};
+
+struct Instruction {
+    Opcode opcode;
+    uint16_t depth = 0;
+    uint32_t operand = 0;
+};
+
+//  Compiled code of one lambda or one top-level form
+class CodeObject : public HeapObject {
+public:
+    void Trace(Tracer* tracer) override;
+
+    std::vector<Instruction> code;
+    std::vector<Object*> constants;
+    std::vector<CodeObject*> functions;
+    size_t arity = 0;
+    size_t frame_size = 0;
+};
+
+//  Compiles analyzed nodes into bytecode
+class Compiler : private NodeVisitor {
+public:
+    explicit Compiler(Scope* global_scope);
+
+    CodeObject* Compile(Object* form);
+
+private:
+    void Visit(ConstantNode* node) override;
+    void Visit(VariableNode* node) override;
+    void Visit(LocalVariableNode* node) override;
+    void Visit(IfNode* node) override;
+    void Visit(AndNode* node) override;
+    void Visit(OrNode* node) override;
+    void Visit(DefineNode* node) override;
+    void Visit(SetNode* node) override;
+    void Visit(LocalSetNode* node) override;
+    void Visit(LambdaNode* node) override;
+    void Visit(CallNode* node) override;
+    void Visit(EvalNode* node) override;
+
+    void CompileNode(Node* node, bool tail);
+    void CompileLogical(const std::vector<Node*>& arguments, Opcode jump, Object* empty);
+    //  Throws SyntaxError if the operand or the depth does not fit
+    void Emit(Opcode opcode, size_t operand = 0, size_t depth = 0);
+    size_t EmitJump(Opcode opcode);
+    void PatchJump(size_t position);
+    size_t AddConstant(Object* value);
+
+    Scope* global_scope_;
+    //  Code objects being compiled, innermost last
+    std::vector<CodeObject*> functions_;
+    RootedVector<CodeObject> code_objects_;
+    bool tail_ = false;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <string_view>
+
+#include <heap.h>
+#include <parser.h>
+
+//  A compact binary form of parsed data, read back in one pass without
+//  tokenizing. Numbers, interned symbols, strings and pairs are stored;
+//  a pair or a string which is reachable several times, even through a
+//  cycle, is stored once and shared again when read. Functions and
+//  syntax cannot be stored.
+//
+//  The data starts with a magic header and a version, followed by the
+//  numbers of pairs and strings, the number of forms and the forms in
+//  preorder.
+
+//  True if the data starts with the header of the binary form
+bool IsFasl(std::string_view data);
+
+std::string WriteFasl(std::span<Object* const> forms);
+
+//  Throws RuntimeError if the data is damaged
+RootedVector<Object> ReadFasl(std::string_view data);
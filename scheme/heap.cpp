@@ -0,0 +1,336 @@
+#include "heap.h"
+
+#include <algorithm>
+#include <cassert>
+#include <bitset>
+
+struct Heap::CellPage {
+    static constexpr size_t kSlots = kCellPageSize / kCellSize;
+    static constexpr size_t kWords = kSlots / 64;
+    //  Slots overlapped by the header are never used
+    static const size_t kFirstSlot;
+
+    CellPage* next;
+    uint64_t marked[kWords];
+    uint64_t allocated[kWords];
+
+    static CellPage* Of(uintptr_t cell) {
+        return reinterpret_cast<CellPage*>(cell & ~(kCellPageSize - 1));
+    }
+
+    static size_t IndexOf(uintptr_t cell) {
+        return (cell & (kCellPageSize - 1)) / kCellSize;
+    }
+
+    void** Slot(size_t index) {
+        return reinterpret_cast<void**>(reinterpret_cast<char*>(this) + index * kCellSize);
+    }
+};
+
+const size_t Heap::CellPage::kFirstSlot = (sizeof(CellPage) + kCellSize - 1) / kCellSize;
+
+/*************  HeapObject  *************/
+void HeapObject::Trace(Tracer*) {
+}
+
+/*************  Tracer  *************/
+void Tracer::Visit(HeapObject* obj) {
+    auto bits = reinterpret_cast<uintptr_t>(obj);
+    if (bits & kFixnumTag) {
+        return;
+    }
+    if (bits & kCellTag) {
+        if (Heap::MarkCell(bits)) {
+            worklist_.push_back(obj);
+        }
+        return;
+    }
+    if (obj && !obj->marked_) {
+        obj->marked_ = true;
+        worklist_.push_back(obj);
+    }
+}
+
+/*************  Heap  *************/
+Heap::Heap() {
+    stats_.threshold_bytes = kInitialThreshold;
+}
+
+Heap::~Heap() {
+    if (current_ == this) {
+        current_ = nullptr;
+    }
+    for (auto root = roots_; root; root = root->next_) {
+        root->heap_ = nullptr;
+    }
+
+    for (auto list : {objects_, unswept_}) {
+        while (list) {
+            auto next = list->next_in_heap_;
+            delete list;
+            list = next;
+        }
+    }
+    for (auto page : {cell_pages_, unswept_pages_}) {
+        while (page) {
+            auto next = page->next;
+            ::operator delete(page, std::align_val_t{kCellPageSize});
+            page = next;
+        }
+    }
+}
+
+Heap& Heap::CreateCurrent() {
+    static thread_local Heap heap;
+    current_ = &heap;
+    return heap;
+}
+
+void Heap::Collect() {
+    CollectWith(nullptr);
+    FinishSweep();
+}
+
+const HeapStats& Heap::GetStats() const {
+    return stats_;
+}
+
+void Heap::MarkPermanent(HeapObject* obj) {
+    obj->marked_ = true;
+}
+
+void Heap::SetStressMode(bool enabled) {
+    stress_mode_ = enabled;
+}
+
+void Heap::ExpectLiveAllocations(size_t bytes) {
+    stats_.threshold_bytes += bytes;
+}
+
+void Heap::Adopt(Heap* other) {
+    assert(!other->roots_);
+    other->FinishSweep();
+
+    //  Free slots of the other heap are found again by the next sweep
+    if (auto obj = other->objects_) {
+        while (obj->next_in_heap_) {
+            obj = obj->next_in_heap_;
+        }
+        obj->next_in_heap_ = objects_;
+        objects_ = other->objects_;
+    }
+    if (auto page = other->cell_pages_) {
+        while (page->next) {
+            page = page->next;
+        }
+        page->next = cell_pages_;
+        cell_pages_ = other->cell_pages_;
+    }
+
+    auto& adopted = other->stats_;
+    stats_.live_objects += adopted.live_objects;
+    stats_.live_bytes += adopted.live_bytes;
+    stats_.allocated_objects += adopted.allocated_objects;
+    allocated_bytes_ += adopted.live_bytes;
+
+    other->objects_ = nullptr;
+    other->cell_pages_ = nullptr;
+    other->free_cells_ = nullptr;
+    other->free_top_ = other->free_end_ = nullptr;
+    other->stats_ = HeapStats{};
+    other->stats_.threshold_bytes = kInitialThreshold;
+}
+
+void Heap::UnlinkRoot(RootBase* root) {
+    auto link = &roots_;
+    while (*link != root) {
+        link = &(*link)->next_;
+    }
+    *link = root->next_;
+}
+
+void* Heap::AllocateCell() {
+    while (!free_cells_ && free_top_ == free_end_ && unswept_pages_) {
+        SweepCellPage();
+    }
+
+    void* cell;
+    if (free_cells_) {
+        cell = free_cells_;
+        free_cells_ = *static_cast<void**>(cell);
+    } else {
+        if (free_top_ == free_end_) {
+            AddCellPage();
+        }
+        cell = free_top_;
+        free_top_ += kCellSize;
+    }
+
+    auto bits = reinterpret_cast<uintptr_t>(cell);
+    auto index = CellPage::IndexOf(bits);
+    CellPage::Of(bits)->allocated[index / 64] |= uint64_t{1} << (index % 64);
+    return cell;
+}
+
+void Heap::RegisterCell(HeapObject* cell) {
+    OnAllocation(cell, kCellSize);
+}
+
+void Heap::AddCellPage() {
+    auto page = static_cast<CellPage*>(
+        ::operator new(kCellPageSize, std::align_val_t{kCellPageSize}));
+    std::fill(std::begin(page->marked), std::end(page->marked), 0);
+    std::fill(std::begin(page->allocated), std::end(page->allocated), 0);
+    page->next = cell_pages_;
+    cell_pages_ = page;
+
+    //  A fresh page is handed out in address order by bumping a pointer,
+    //  without threading a free list through it first
+    free_top_ = reinterpret_cast<char*>(page->Slot(CellPage::kFirstSlot));
+    free_end_ = reinterpret_cast<char*>(page) + kCellPageSize;
+}
+
+bool Heap::MarkCell(uintptr_t cell) {
+    auto page = CellPage::Of(cell);
+    auto index = CellPage::IndexOf(cell);
+    auto& word = page->marked[index / 64];
+    auto bit = uint64_t{1} << (index % 64);
+    if (word & bit) {
+        return false;
+    }
+    word |= bit;
+    return true;
+}
+
+void Heap::Register(HeapObject* obj, size_t size) {
+    obj->size_ = static_cast<uint32_t>(size);
+    OnAllocation(obj, size);
+}
+
+void Heap::OnAllocation(HeapObject* obj, size_t size) {
+    ++stats_.live_objects;
+    ++stats_.allocated_objects;
+    stats_.live_bytes += size;
+    allocated_bytes_ += size;
+
+    //  The new object is not reachable from any root yet,
+    //  so it is kept alive explicitly together with its fields
+    if (stress_mode_ || marked_bytes_ + allocated_bytes_ > stats_.threshold_bytes) {
+        CollectWith(obj);
+    } else if (unswept_ || unswept_pages_) {
+        SweepStep();
+    }
+}
+
+void Heap::CollectWith(HeapObject* pending) {
+    auto start = std::chrono::steady_clock::now();
+
+    //  Marks of the previous collection are cleared by its sweep
+    FinishSweep();
+    Mark(pending);
+
+    unswept_ = objects_;
+    objects_ = nullptr;
+    unswept_pages_ = cell_pages_;
+    cell_pages_ = nullptr;
+    free_cells_ = nullptr;
+    //  The rest of a fresh page is not allocated, so the sweep frees it
+    free_top_ = free_end_ = nullptr;
+
+    allocated_bytes_ = 0;
+    stats_.threshold_bytes = std::max(kInitialThreshold, 2 * marked_bytes_);
+
+    auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+    ++stats_.collections;
+    stats_.last_pause = pause;
+    stats_.max_pause = std::max(stats_.max_pause, pause);
+    stats_.total_pause += pause;
+}
+
+void Heap::Mark(HeapObject* pending) {
+    tracer_.Visit(pending);
+    for (auto root = roots_; root; root = root->next_) {
+        root->Trace(&tracer_);
+    }
+
+    marked_bytes_ = 0;
+    while (!tracer_.worklist_.empty()) {
+        auto obj = tracer_.worklist_.back();
+        tracer_.worklist_.pop_back();
+        auto bits = reinterpret_cast<uintptr_t>(obj);
+        if (bits & kCellTag) {
+            auto fields = reinterpret_cast<HeapObject**>(bits & ~kTagMask);
+            tracer_.Visit(fields[0]);
+            tracer_.Visit(fields[1]);
+            marked_bytes_ += kCellSize;
+        } else {
+            obj->Trace(&tracer_);
+            marked_bytes_ += obj->size_;
+        }
+    }
+}
+
+void Heap::SweepStep() {
+    for (size_t it = 0; it < kSweepStep && unswept_; ++it) {
+        SweepObject();
+    }
+    if (!unswept_ && unswept_pages_) {
+        SweepCellPage();
+    }
+}
+
+void Heap::FinishSweep() {
+    while (unswept_) {
+        SweepObject();
+    }
+    while (unswept_pages_) {
+        SweepCellPage();
+    }
+}
+
+void Heap::SweepObject() {
+    auto obj = unswept_;
+    unswept_ = obj->next_in_heap_;
+    if (obj->marked_) {
+        obj->marked_ = false;
+        obj->next_in_heap_ = objects_;
+        objects_ = obj;
+    } else {
+        --stats_.live_objects;
+        ++stats_.freed_objects;
+        stats_.live_bytes -= obj->size_;
+        delete obj;
+    }
+}
+
+void Heap::SweepCellPage() {
+    auto page = unswept_pages_;
+    unswept_pages_ = page->next;
+
+    size_t live = 0;
+    for (size_t it = 0; it < CellPage::kWords; ++it) {
+        auto freed = std::bitset<64>(page->allocated[it] & ~page->marked[it]).count();
+        stats_.live_objects -= freed;
+        stats_.freed_objects += freed;
+        stats_.live_bytes -= freed * kCellSize;
+
+        page->allocated[it] &= page->marked[it];
+        page->marked[it] = 0;
+        live += std::bitset<64>(page->allocated[it]).count();
+    }
+
+    if (!live) {
+        ::operator delete(page, std::align_val_t{kCellPageSize});
+        return;
+    }
+
+    for (size_t index = CellPage::kSlots; index-- > CellPage::kFirstSlot;) {
+        if (!(page->allocated[index / 64] & (uint64_t{1} << (index % 64)))) {
+            *page->Slot(index) = free_cells_;
+            free_cells_ = page->Slot(index);
+        }
+    }
+    page->next = cell_pages_;
+    cell_pages_ = page;
+}
@@ -0,0 +1,332 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+class Heap;
+class Tracer;
+
+//  Values are pointers whose lowest bits may hold a tag. Fixnums are
+//  integers stored in the pointer itself, cell pointers refer to a pair in
+//  a cell page. Heap objects are aligned, so untagged pointers have zeros
+//  in these bits.
+constexpr uintptr_t kFixnumTag = 1;
+constexpr uintptr_t kCellTag = 2;
+constexpr uintptr_t kTagMask = 3;
+
+//  Base class of everything owned by the garbage collector
+class HeapObject {
+public:
+    HeapObject() = default;
+    HeapObject(const HeapObject&) = delete;
+    HeapObject& operator=(const HeapObject&) = delete;
+    virtual ~HeapObject() = default;
+
+    //  Report every heap object directly referenced by this one
+    virtual void Trace(Tracer* tracer);
+
+private:
+    friend class Heap;
+    friend class Tracer;
+
+    HeapObject* next_in_heap_ = nullptr;
+    uint32_t size_ = 0;
+    bool marked_ = false;
+};
+
+//  Collects reachable objects during the mark phase. Uses an explicit
+//  worklist, so arbitrarily deep structures do not consume C++ stack.
+class Tracer {
+public:
+    void Visit(HeapObject* obj);
+
+private:
+    friend class Heap;
+
+    std::vector<HeapObject*> worklist_;
+};
+
+//  Base class for C++ values which keep heap objects alive.
+//  Roots register themselves in the heap of the current thread. They are
+//  kept in a stack, as almost all of them are locals destroyed in reverse
+//  order of construction, which makes registration a couple of stores.
+class RootBase {
+public:
+    RootBase(const RootBase&) = delete;
+    RootBase& operator=(const RootBase&) = delete;
+
+protected:
+    RootBase();
+    virtual ~RootBase();
+
+private:
+    friend class Heap;
+
+    virtual void Trace(Tracer* tracer) = 0;
+
+    Heap* heap_;
+    RootBase* next_;
+};
+
+//  A pointer to a heap object which is a root for the collector.
+//  Raw pointers are only valid until the next allocation.
+template <class T>
+class Handle : public RootBase {
+public:
+    Handle(T* ptr = nullptr) : ptr_(ptr) {
+    }
+
+    Handle(const Handle& other) : ptr_(other.ptr_) {
+    }
+
+    template <class U>
+    Handle(const Handle<U>& other) : ptr_(other.Get()) {
+    }
+
+    Handle& operator=(const Handle& other) {
+        ptr_ = other.ptr_;
+        return *this;
+    }
+
+    Handle& operator=(T* ptr) {
+        ptr_ = ptr;
+        return *this;
+    }
+
+    T* Get() const {
+        return ptr_;
+    }
+
+    T* operator->() const {
+        return ptr_;
+    }
+
+    operator T*() const {
+        return ptr_;
+    }
+
+private:
+    void Trace(Tracer* tracer) override {
+        tracer->Visit(ptr_);
+    }
+
+    T* ptr_;
+};
+
+//  A vector of pointers to heap objects, all of which are roots
+template <class T>
+class RootedVector : public RootBase {
+public:
+    RootedVector() = default;
+
+    explicit RootedVector(std::vector<T*> items) : items_(std::move(items)) {
+    }
+
+    RootedVector(const RootedVector& other) : items_(other.items_) {
+    }
+
+    T*& operator[](size_t index) {
+        return items_[index];
+    }
+
+    void reserve(size_t size) {
+        items_.reserve(size);
+    }
+
+    void push_back(T* item) {
+        items_.push_back(item);
+    }
+
+    size_t size() const {
+        return items_.size();
+    }
+
+    auto begin() {
+        return items_.begin();
+    }
+
+    auto end() {
+        return items_.end();
+    }
+
+    operator const std::vector<T*>&() const {
+        return items_;
+    }
+
+private:
+    void Trace(Tracer* tracer) override {
+        for (auto item : items_) {
+            tracer->Visit(item);
+        }
+    }
+
+    std::vector<T*> items_;
+};
+
+struct HeapStats {
+    size_t collections = 0;
+    size_t live_objects = 0;
+    size_t live_bytes = 0;
+    size_t threshold_bytes = 0;
+    size_t allocated_objects = 0;
+    size_t freed_objects = 0;
+    std::chrono::nanoseconds last_pause{0};
+    std::chrono::nanoseconds max_pause{0};
+    std::chrono::nanoseconds total_pause{0};
+};
+
+//  Mark-and-sweep heap. Every thread has its own heap, which owns all
+//  objects allocated with Make() on that thread. A collection starts
+//  automatically once the live size exceeds a threshold, which is twice
+//  the live size after the previous collection.
+//
+//  Sweeping is lazy: an automatic collection only marks, and unreachable
+//  objects and pairs are freed a few at a time by the allocations that
+//  follow. Dropping a large structure therefore neither recurses nor adds
+//  its size to the pause. Collect() sweeps everything before returning.
+class Heap {
+public:
+    Heap();
+    Heap(const Heap&) = delete;
+    Heap& operator=(const Heap&) = delete;
+    ~Heap();
+
+    static Heap& Current() {
+        if (auto heap = current_) {
+            return *heap;
+        }
+        return CreateCurrent();
+    }
+
+    template <class T, class... Args>
+    T* Make(Args&&... args) {
+        T* obj = new T(std::forward<Args>(args)...);
+        obj->next_in_heap_ = objects_;
+        objects_ = obj;
+        Register(obj, sizeof(T));
+        return obj;
+    }
+
+    //  Returns an uninitialized two-word slot for a pair. RegisterCell must
+    //  be called with the tagged pointer once the slot is filled.
+    void* AllocateCell();
+    void RegisterCell(HeapObject* cell);
+
+    void Collect();
+    const HeapStats& GetStats() const;
+
+    //  Objects which live outside of any heap (static singletons) are marked
+    //  permanently, so the collector neither traces nor frees them.
+    static void MarkPermanent(HeapObject* obj);
+
+    //  Collect on every allocation. Used to test that all roots are registered.
+    void SetStressMode(bool enabled);
+
+    //  Announces allocations of about the given size which will all stay
+    //  reachable, like a structure being built, so that they do not start a
+    //  collection which could not free anything
+    void ExpectLiveAllocations(size_t bytes);
+
+    //  Takes over every object of another heap, which must have no roots.
+    //  Objects stay in place, so pointers into the other heap remain valid;
+    //  they are collected by this heap once unreachable.
+    void Adopt(Heap* other);
+
+private:
+    friend class RootBase;
+    friend class HeapScope;
+    friend class Tracer;
+
+    //  Pairs have no header: they live in aligned pages of two-word slots,
+    //  and their mark bits are kept in a bitmap at the start of the page.
+    struct CellPage;
+
+    static constexpr size_t kCellPageSize = 64 << 10;
+    static constexpr size_t kCellSize = 2 * sizeof(void*);
+
+    static constexpr size_t kInitialThreshold = 1 << 20;
+    //  Objects swept per allocation, pages of pairs are swept one at a time
+    static constexpr size_t kSweepStep = 16;
+
+    //  A plain pointer is cheaper to access than a thread_local object
+    static inline thread_local Heap* current_ = nullptr;
+    static Heap& CreateCurrent();
+
+    //  Roots destroyed out of order are searched for in the stack
+    void UnlinkRoot(RootBase* root);
+    void Register(HeapObject* obj, size_t size);
+    //  May start a collection, which keeps the new object alive
+    void OnAllocation(HeapObject* obj, size_t size);
+    void CollectWith(HeapObject* pending);
+    void Mark(HeapObject* pending);
+    //  Frees a bounded amount of garbage left by the last collection
+    void SweepStep();
+    void FinishSweep();
+    void SweepObject();
+    void SweepCellPage();
+    void AddCellPage();
+    //  Returns false if the cell was already marked
+    static bool MarkCell(uintptr_t cell);
+
+    HeapObject* objects_ = nullptr;
+    //  Not yet examined since the last mark phase
+    HeapObject* unswept_ = nullptr;
+    CellPage* cell_pages_ = nullptr;
+    CellPage* unswept_pages_ = nullptr;
+    void* free_cells_ = nullptr;
+    //  Unused part of the newest page
+    char* free_top_ = nullptr;
+    char* free_end_ = nullptr;
+    //  Garbage is counted in the live size until it is swept, so
+    //  collections are started by these instead
+    size_t marked_bytes_ = 0;
+    size_t allocated_bytes_ = 0;
+    RootBase* roots_ = nullptr;
+    Tracer tracer_;
+    HeapStats stats_;
+    bool stress_mode_ = false;
+};
+
+inline RootBase::RootBase() : heap_(&Heap::Current()), next_(heap_->roots_) {
+    heap_->roots_ = this;
+}
+
+inline RootBase::~RootBase() {
+    if (!heap_) {
+        return;
+    }
+    if (heap_->roots_ == this) {
+        heap_->roots_ = next_;
+    } else {
+        heap_->UnlinkRoot(this);
+    }
+}
+
+//  Makes another heap current on this thread for the lifetime of the scope,
+//  so objects may be built in a private heap and adopted by another later
+class HeapScope {
+public:
+    explicit HeapScope(Heap* heap) : previous_(Heap::current_) {
+        Heap::current_ = heap;
+    }
+
+    HeapScope(const HeapScope&) = delete;
+    HeapScope& operator=(const HeapScope&) = delete;
+
+    ~HeapScope() {
+        Heap::current_ = previous_;
+    }
+
+private:
+    Heap* previous_;
+};
+
+//  Allocate an object in the heap of the current thread
+template <class T, class... Args>
+T* Make(Args&&... args) {
+    return Heap::Current().Make<T>(std::forward<Args>(args)...);
+}
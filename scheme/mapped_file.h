@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+//  Contents of a file mapped read-only into memory, so it is scanned in place
+//  without copying. The mapping lives as long as the object.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    std::string_view GetContents() const;
+
+private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+};
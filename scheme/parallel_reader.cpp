@@ -0,0 +1,172 @@
+#include "parallel_reader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <exception>
+#include <memory>
+#include <thread>
+
+namespace {
+
+//  Chunks are smaller than an even share of the input, so threads which
+//  are done early take over the rest
+constexpr size_t kChunksPerThread = 4;
+constexpr size_t kMinChunkSize = 64 << 10;
+
+struct Chunk {
+    std::string_view text;
+    std::unique_ptr<Heap> heap;
+    std::vector<Object*> forms;
+    std::exception_ptr error;
+};
+
+void ReadChunk(Chunk* chunk) {
+    chunk->heap = std::make_unique<Heap>();
+    try {
+        HeapScope scope(chunk->heap.get());
+        RootedVector<Object> forms;
+        Tokenizer tokenizer{chunk->text};
+        while (!tokenizer.IsEnd()) {
+            forms.push_back(Read(&tokenizer));
+        }
+        chunk->forms = forms;
+    } catch (...) {
+        chunk->error = std::current_exception();
+    }
+}
+
+}  // namespace
+
+std::vector<size_t> FindFormBoundaries(std::string_view input, size_t chunk_size) {
+    std::vector<size_t> boundaries = {0};
+    int depth = 0;
+    bool in_string = false;
+    //  Position of the character after a backslash in a string
+    size_t escaped = std::string_view::npos;
+    //  Last character outside of strings which is not a space
+    char last = 0;
+
+    for (size_t it = 0; it < input.size();) {
+        //  Far from the next split only lists and strings are followed, using
+        //  the structural index of a whole block
+        if (it % kBlockSize == 0 && it + kBlockSize <= input.size() &&
+            it + kBlockSize < boundaries.back() + chunk_size) {
+            auto masks = ClassifyBlock(input.data() + it);
+            for (auto bits = masks.open | masks.close | masks.string | masks.escape; bits;
+                 bits &= bits - 1) {
+                auto position = it + std::countr_zero(bits);
+                auto ch = input[position];
+                if (in_string) {
+                    if (position == escaped) {
+                        continue;
+                    } else if (ch == '\\') {
+                        escaped = position + 1;
+                    } else if (ch == '"') {
+                        in_string = false;
+                    }
+                } else if (ch == '(') {
+                    ++depth;
+                } else if (ch == ')') {
+                    --depth;
+                } else if (ch == '"') {
+                    in_string = true;
+                }
+            }
+
+            //  A string is opened by the last character before its contents
+            if (in_string) {
+                last = '"';
+            } else if (auto others = ~masks.space) {
+                last = input[it + kBlockSize - 1 - std::countl_zero(others)];
+            }
+            it += kBlockSize;
+            continue;
+        }
+
+        auto ch = input[it++];
+        if (in_string) {
+            if (it - 1 == escaped) {
+                continue;
+            } else if (ch == '\\') {
+                escaped = it;
+            } else if (ch == '"') {
+                in_string = false;
+            }
+            continue;
+        }
+
+        if (ch == '(') {
+            ++depth;
+        } else if (ch == ')') {
+            --depth;
+        } else if (ch == '"') {
+            in_string = true;
+        }
+        if (!HasCharClass(static_cast<unsigned char>(ch), kSpaceChar)) {
+            last = ch;
+        }
+
+        if (it - boundaries.back() < chunk_size || depth != 0 || in_string || last == '\'' ||
+            it == input.size()) {
+            continue;
+        }
+        //  Splits are made right before a token, after all spaces, so the
+        //  sign check sees its first character
+        auto next = static_cast<unsigned char>(input[it]);
+        if ((ch == ')' || HasCharClass(static_cast<unsigned char>(ch), kSpaceChar)) &&
+            !HasCharClass(next, kSpaceChar) && next != '+' && next != '-') {
+            boundaries.push_back(it);
+        }
+    }
+
+    boundaries.push_back(input.size());
+    return boundaries;
+}
+
+RootedVector<Object> ReadFormsParallel(std::string_view input, size_t threads) {
+    threads = std::max<size_t>(threads, 1);
+    auto chunk_size = std::max(kMinChunkSize, input.size() / (threads * kChunksPerThread) + 1);
+    auto boundaries = FindFormBoundaries(input, chunk_size);
+
+    std::vector<Chunk> chunks(boundaries.size() - 1);
+    for (size_t it = 0; it < chunks.size(); ++it) {
+        chunks[it].text = input.substr(boundaries[it], boundaries[it + 1] - boundaries[it]);
+    }
+
+    //  Workers take the next chunk until none are left
+    std::atomic<size_t> next_chunk = 0;
+    auto work = [&chunks, &next_chunk] {
+        for (size_t it; (it = next_chunk++) < chunks.size();) {
+            ReadChunk(&chunks[it]);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t it = 1; it < std::min(threads, chunks.size()); ++it) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    //  Adopting does not allocate, so forms are rooted before any collection
+    size_t count = 0;
+    for (auto& chunk : chunks) {
+        if (chunk.error) {
+            std::rethrow_exception(chunk.error);
+        }
+        count += chunk.forms.size();
+    }
+
+    RootedVector<Object> forms;
+    forms.reserve(count);
+    auto& heap = Heap::Current();
+    for (auto& chunk : chunks) {
+        heap.Adopt(chunk.heap.get());
+        for (auto form : chunk.forms) {
+            forms.push_back(form);
+        }
+    }
+    return forms;
+}
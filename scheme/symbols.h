@@ -3,13 +3,37 @@
 #include <scope.h>
 #include <parser.h>
 
+//  #t and #f are singletons, so booleans are compared by pointer
 class True : public Symbol {
 public:
+    static True* Instance();
+    Object* Eval(Scope* scope) override;
+
+private:
     True();
 };
 
 class False : public Symbol {
 public:
+    static False* Instance();
+    Object* Eval(Scope* scope) override;
+
+private:
     False();
-    bool IsFalse() const override;
 };
+
+inline Object* ToBoolean(bool value) {
+    if (value) {
+        return True::Instance();
+    }
+    return False::Instance();
+}
+
+//  Only #f is false
+inline bool IsFalse(Object* obj) {
+    return obj == False::Instance();
+}
+
+inline bool IsBoolean(Object* obj) {
+    return obj == True::Instance() || obj == False::Instance();
+}
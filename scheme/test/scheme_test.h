@@ -1,12 +1,27 @@
 #pragma once
 
+#include <cstdlib>
+#include <string>
+
 #include <catch.hpp>
 #include <scheme.h>
 
+//  SCHEME_ENGINE=bytecode runs the whole suite on the virtual machine
+inline Engine EngineFromEnvironment() {
+    auto engine = std::getenv("SCHEME_ENGINE");
+    if (engine && std::string(engine) == "bytecode") {
+        return Engine::BYTECODE;
+    }
+    return Engine::TREE_WALKER;
+}
+
 struct SchemeTest {
     Scheme scheme;
 
-    SchemeTest() {
+    SchemeTest() : scheme(EngineFromEnvironment()) {
+    }
+
+    explicit SchemeTest(Engine engine) : scheme(engine) {
     }
 
     // Implement following methods.
@@ -21,12 +36,12 @@ struct SchemeTest {
 
     void ExpectNoError(std::string expression) {
         REQUIRE_NOTHROW(scheme.ReadCommand(expression));
-        std::shared_ptr<Object> parsed_expression = scheme.ReadCommand(expression);
+        Handle<Object> parsed_expression = scheme.ReadCommand(expression);
         REQUIRE_NOTHROW(scheme.Eval(parsed_expression));
     }
 
     void ExpectSyntaxError(std::string expression) {
-        std::shared_ptr<Object> parsed_expression;
+        Handle<Object> parsed_expression;
         REQUIRE_THROWS_AS(scheme.Eval(scheme.ReadCommand(expression)), SyntaxError);
     }
 
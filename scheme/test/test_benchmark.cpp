@@ -0,0 +1,391 @@
+#include <test/scheme_test.h>
+
+#include <fasl.h>
+#include <mapped_file.h>
+#include <parallel_reader.h>
+
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+//  Benchmarks are hidden from the default run, use `test_scheme [benchmark]`
+
+namespace {
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+TEST_CASE_METHOD(SchemeTest, "Fib allocations", "[.][benchmark]") {
+    ExpectNoError("(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))");
+    auto command = scheme.ReadCommand("(fib 25)");
+
+    auto allocated_before = scheme.GetHeapStats().allocated_objects;
+    auto start = std::chrono::steady_clock::now();
+    scheme.Eval(command);
+    auto seconds = SecondsSince(start);
+    auto allocated = scheme.GetHeapStats().allocated_objects - allocated_before;
+
+    std::cout << "(fib 25): " << allocated << " allocations, " << seconds << " s\n";
+}
+
+TEST_CASE_METHOD(SchemeTest, "Arithmetic loop allocations", "[.][benchmark]") {
+    ExpectNoError("(define (sum n acc) (if (= n 0) acc (sum (- n 1) (+ acc n))))");
+    auto command = scheme.ReadCommand("(sum 10000 0)");
+
+    auto allocated_before = scheme.GetHeapStats().allocated_objects;
+    auto start = std::chrono::steady_clock::now();
+    scheme.Eval(command);
+    auto seconds = SecondsSince(start);
+    auto allocated = scheme.GetHeapStats().allocated_objects - allocated_before;
+
+    std::cout << "(sum 10000 0): " << allocated << " allocations, " << seconds << " s\n";
+}
+
+TEST_CASE_METHOD(SchemeTest, "Recursive fib", "[.][benchmark]") {
+    //  The inner lambda gives every call its own copy of the parameter
+    ExpectNoError(
+        "(define (fib n) ((lambda (m) (if (< m 2) m (+ (fib (- m 1)) (fib (- m 2))))) n))");
+    auto command = scheme.ReadCommand("(fib 25)");
+
+    auto start = std::chrono::steady_clock::now();
+    auto result = scheme.Eval(command);
+    auto seconds = SecondsSince(start);
+
+    REQUIRE(Print(result) == "75025");
+    std::cout << "recursive (fib 25): " << seconds << " s\n";
+}
+
+TEST_CASE("Recursive fib on bytecode", "[.][benchmark]") {
+    SchemeTest test(Engine::BYTECODE);
+    test.ExpectNoError("(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))");
+    auto command = test.scheme.ReadCommand("(fib 25)");
+
+    auto start = std::chrono::steady_clock::now();
+    auto result = test.scheme.Eval(command);
+    auto seconds = SecondsSince(start);
+
+    REQUIRE(Print(result) == "75025");
+    std::cout << "bytecode (fib 25): " << seconds << " s\n";
+}
+
+TEST_CASE_METHOD(SchemeTest, "Root registration", "[.][benchmark]") {
+    constexpr size_t kIterations = 10000000;
+    Handle<Object> value = scheme.ReadCommand("(1 2 3)");
+
+    //  Every C++ copy of a pointer into the heap goes through a handle
+    size_t matches = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t it = 0; it < kIterations; ++it) {
+        Handle<Object> copy(value);
+        Handle<Object> another(copy);
+        matches += another.Get() == value.Get();
+    }
+    auto seconds = SecondsSince(start);
+    REQUIRE(matches == kIterations);
+    std::cout << "handle copy: " << seconds / (2 * kIterations) * 1e9 << " ns\n";
+
+    ExpectNoError("(define (range a b) (if (= a b) '() (cons a (range (+ a 1) b))))");
+    ExpectNoError("(define (len l) (if (null? l) 0 (+ 1 (len (cdr l)))))");
+    auto command = scheme.ReadCommand("(len (range 0 1000))");
+
+    start = std::chrono::steady_clock::now();
+    for (size_t it = 0; it < 300; ++it) {
+        scheme.Eval(command);
+    }
+    seconds = SecondsSince(start);
+    std::cout << "300 x (len (range 0 1000)): " << seconds << " s\n";
+}
+
+TEST_CASE("Read 100 MB", "[.][benchmark]") {
+    std::string text = "(";
+    while (text.size() < (100 << 20)) {
+        text += "(define-record some-long-symbol-name 123456789 (nested . pair))\n";
+    }
+    text += ")";
+
+    std::stringstream stream{text};
+    auto start = std::chrono::steady_clock::now();
+    {
+        Tokenizer tokenizer{&stream};
+        Handle<Object> result = Read(&tokenizer);
+        REQUIRE(IsCell(result));
+    }
+    Heap::Current().Collect();
+    auto seconds = SecondsSince(start);
+
+    std::cout << "stream: " << (text.size() >> 20) / seconds << " MB/s\n";
+
+    //  Scanned in place instead of through a stream
+    auto& heap = Heap::Current();
+    auto allocated_before = heap.GetStats().allocated_objects;
+    auto live_before = heap.GetStats().live_bytes;
+    size_t pairs = 0;
+    size_t bytes = 0;
+    start = std::chrono::steady_clock::now();
+    {
+        Tokenizer tokenizer{std::string_view(text)};
+        Handle<Object> result = Read(&tokenizer);
+        REQUIRE(IsCell(result));
+        pairs = heap.GetStats().allocated_objects - allocated_before;
+        bytes = heap.GetStats().live_bytes - live_before;
+    }
+    heap.Collect();
+    seconds = SecondsSince(start);
+
+    std::cout << "buffer: " << (text.size() >> 20) / seconds << " MB/s, " << pairs << " pairs of "
+              << bytes / pairs << " bytes\n";
+
+    //  The pairs of the reader alone, taken from cell pages
+    start = std::chrono::steady_clock::now();
+    {
+        Handle<Object> list;
+        for (size_t it = 0; it < pairs; ++it) {
+            list = MakeCell(nullptr, list);
+        }
+    }
+    heap.Collect();
+    seconds = SecondsSince(start);
+
+    std::cout << "cell pages: " << pairs / seconds / 1e6 << " M pairs/s\n";
+}
+
+TEST_CASE_METHOD(SchemeTest, "Load 20 MB file", "[.][benchmark]") {
+    auto path = (std::filesystem::temp_directory_path() / "scheme_load_benchmark.scm").string();
+    size_t size = 0;
+    {
+        std::ofstream file(path);
+        std::string form = "'(some-long-symbol-name 123456789 (nested . pair))\n";
+        for (; size < (20 << 20); size += form.size()) {
+            file << form;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    scheme.LoadFile(path);
+    auto seconds = SecondsSince(start);
+    std::remove(path.c_str());
+
+    std::cout << "load: " << (size >> 20) / seconds << " MB/s\n";
+}
+
+TEST_CASE_METHOD(SchemeTest, "Parallel read scaling", "[.][benchmark]") {
+    auto path = (std::filesystem::temp_directory_path() / "scheme_parallel_benchmark.scm").string();
+    {
+        std::ofstream file(path);
+        std::string form = "(define-record some-long-symbol-name 123456789 (nested . pair))\n";
+        for (size_t size = 0; size < (100 << 20); size += form.size()) {
+            file << form;
+        }
+    }
+    MappedFile file(path);
+    auto input = file.GetContents();
+    auto megabytes = input.size() >> 20;
+
+    //  Forms are kept, as the parallel reader returns all of them
+    auto start = std::chrono::steady_clock::now();
+    size_t count = 0;
+    {
+        RootedVector<Object> forms;
+        scheme.ReadForms(input, [&forms](Object* form) { forms.push_back(form); });
+        count = forms.size();
+    }
+    std::cout << "sequential: " << megabytes / SecondsSince(start) << " MB/s\n";
+    Heap::Current().Collect();
+
+    auto cores = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= cores; threads *= 2) {
+        start = std::chrono::steady_clock::now();
+        {
+            auto forms = ReadFormsParallel(input, threads);
+            REQUIRE(forms.size() == count);
+        }
+        std::cout << threads << " threads: " << megabytes / SecondsSince(start) << " MB/s\n";
+        Heap::Current().Collect();
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Tokenize 100 MB", "[.][benchmark]") {
+    std::string text;
+    while (text.size() < (100 << 20)) {
+        text += "(define-record some-long-symbol-name 123456789 (nested . pair) \"text\")\n";
+    }
+    auto megabytes = text.size() >> 20;
+
+    auto start = std::chrono::steady_clock::now();
+    size_t tokens = 0;
+    for (Tokenizer tokenizer{std::string_view(text)}; !tokenizer.IsEnd(); tokenizer.Next()) {
+        ++tokens;
+    }
+    std::cout << "tokenizer: " << megabytes / SecondsSince(start) << " MB/s\n";
+
+    //  The structural index alone, vectorized and one character at a time
+    for (bool vectorized : {true, false}) {
+        start = std::chrono::steady_clock::now();
+        uint64_t spaces = 0;
+        for (size_t it = 0; it + kBlockSize <= text.size(); it += kBlockSize) {
+            auto masks = vectorized ? ClassifyBlock(text.data() + it)
+                                    : ClassifyScalar(text.data() + it, kBlockSize);
+            spaces += std::popcount(masks.space);
+        }
+        REQUIRE(spaces > 0);
+        std::cout << (vectorized ? "classify: " : "classify scalar: ")
+                  << megabytes / SecondsSince(start) << " MB/s\n";
+    }
+}
+
+TEST_CASE_METHOD(SchemeTest, "Read FASL", "[.][benchmark]") {
+    std::string text;
+    while (text.size() < (20 << 20)) {
+        text += "(define (some-function argument) (if (< argument 100) (list 'small argument) "
+                "(cons \"large\" (some-function (- argument 1)))))\n";
+    }
+    auto megabytes = static_cast<double>(text.size() >> 20);
+
+    std::string data;
+    size_t count = 0;
+    {
+        RootedVector<Object> forms;
+        scheme.ReadForms(text, [&forms](Object* form) { forms.push_back(form); });
+        data = WriteFasl(static_cast<const std::vector<Object*>&>(forms));
+        count = forms.size();
+    }
+
+    //  Both reads start from a warm heap which holds none of the forms
+    Heap::Current().Collect();
+    auto start = std::chrono::steady_clock::now();
+    {
+        RootedVector<Object> forms;
+        scheme.ReadForms(text, [&forms](Object* form) { forms.push_back(form); });
+    }
+    auto text_seconds = SecondsSince(start);
+
+    Heap::Current().Collect();
+    start = std::chrono::steady_clock::now();
+    {
+        auto copy = ReadFasl(data);
+        REQUIRE(copy.size() == count);
+    }
+    auto fasl_seconds = SecondsSince(start);
+
+    std::cout << "text: " << megabytes / text_seconds << " MB/s\n"
+              << "fasl: " << megabytes / fasl_seconds << " MB/s of source, "
+              << (data.size() >> 20) << " MB of data, " << text_seconds / fasl_seconds
+              << "x faster\n";
+}
+
+TEST_CASE("Read nested input", "[.][benchmark]") {
+    std::string text = "(";
+    auto nested = std::string(200, '(') + "x" + std::string(200, ')') + "\n";
+    while (text.size() < (20 << 20)) {
+        text += "(a (b (c (d (e 1 '2) 3) '(4 . 5)) 6) 7)\n" + nested;
+    }
+    text += ")";
+
+    std::stringstream stream{text};
+    Tokenizer tokenizer{&stream};
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        Handle<Object> result = Read(&tokenizer);
+        REQUIRE(IsCell(result));
+    }
+    auto seconds = SecondsSince(start);
+
+    std::cout << "nested: " << (text.size() >> 20) / seconds << " MB/s\n";
+}
+
+TEST_CASE_METHOD(SchemeTest, "Million-element list", "[.][benchmark]") {
+    std::string text = "(define numbers '(";
+    for (int i = 0; i < 1000000; ++i) {
+        text += std::to_string(i % 1000) + " ";
+    }
+    text += "))";
+
+    auto& heap = Heap::Current();
+    heap.Collect();
+    auto live_before = heap.GetStats().live_bytes;
+    scheme.Eval(scheme.ReadCommand(text));
+    heap.Collect();
+    auto bytes = heap.GetStats().live_bytes - live_before;
+
+    auto command = scheme.ReadCommand("(list-ref numbers 999999)");
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(Print(scheme.Eval(command)) == "999");
+    }
+    auto seconds = SecondsSince(start);
+
+    std::cout << "1M-element list: " << bytes / 1000000.0 << " bytes per pair, "
+              << seconds / 100 * 1e3 << " ms per traversal\n";
+}
+
+TEST_CASE_METHOD(SchemeTest, "Type dispatch", "[.][benchmark]") {
+    constexpr size_t kIterations = 10000000;
+    RootedVector<Object> values;
+    values.push_back(MakeFixnum(1));
+    values.push_back(Intern("a"));
+    values.push_back(scheme.Eval(scheme.ReadCommand("car")));
+    values.push_back(scheme.ReadCommand("(1)"));
+    values.push_back(scheme.Eval(scheme.ReadCommand("if")));
+
+    size_t functions = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t it = 0; it < kIterations; ++it) {
+        auto value = values[it % values.size()];
+        functions += !IsTagged(value) && dynamic_cast<Function*>(value);
+    }
+    auto rtti = SecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t it = 0; it < kIterations; ++it) {
+        functions += IsFunction(values[it % values.size()]);
+    }
+    auto tags = SecondsSince(start);
+
+    REQUIRE(functions == 2 * kIterations / values.size());
+    std::cout << "type test: dynamic_cast " << rtti / kIterations * 1e9 << " ns, type tag "
+              << tags / kIterations * 1e9 << " ns\n";
+
+    ExpectNoError("(define (sum n acc) (if (= n 0) acc (sum (- n 1) (+ acc (* 2 n)))))");
+    ExpectNoError("(define (range a b) (if (= a b) '() (cons a (range (+ a 1) b))))");
+    ExpectNoError("(define numbers (range 0 1000))");
+    ExpectNoError(
+        "(define (walk l acc) (if (null? l) acc (walk (cdr l) (+ acc (car l)))))");
+
+    start = std::chrono::steady_clock::now();
+    ExpectEq("(sum 1000000 0)", "1000001000000");
+    auto arithmetic = SecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 1000; ++i) {
+        ExpectEq("(walk numbers 0)", "499500");
+    }
+    auto lists = SecondsSince(start);
+
+    std::cout << "arithmetic: " << arithmetic << " s, lists: " << lists << " s\n";
+}
+
+TEST_CASE_METHOD(SchemeTest, "Dropping million-element lists", "[.][benchmark]") {
+    ExpectNoError("(define (build n acc) (if (= n 0) acc (build (- n 1) (cons n acc))))");
+    ExpectNoError("(define numbers 0)");
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10; ++i) {
+        ExpectNoError("(set! numbers (build 1000000 '()))");
+    }
+    auto seconds = SecondsSince(start);
+
+    auto stats = scheme.GetHeapStats();
+    std::cout << "10 x 1M-element list: " << seconds << " s, " << stats.collections
+              << " collections, max pause "
+              << std::chrono::duration<double, std::milli>(stats.max_pause).count() << " ms\n";
+}
@@ -0,0 +1,108 @@
+#include <test/scheme_test.h>
+
+#include <string>
+
+TEST_CASE_METHOD(SchemeTest, "LexicalAddressing") {
+    ExpectNoError("(define x 'global)");
+    ExpectEq("((lambda (x) x) 1)", "1");
+    ExpectEq("x", "global");
+    ExpectEq("(((lambda (x) (lambda (y) (list x y))) 1) 2)", "(1 2)");
+    ExpectEq("(((lambda (x) (lambda (x) x)) 1) 2)", "2");
+
+    //  Parameters shadow special forms
+    ExpectEq("((lambda (if) (if 1 2)) (lambda (a b) (+ a b)))", "3");
+
+    //  Internal definitions and set! of captured variables
+    ExpectNoError(
+        "(define make-counter (lambda () (define n 0) (lambda () (set! n (+ n 1)) n)))");
+    ExpectNoError("(define counter (make-counter))");
+    ExpectEq("(counter)", "1");
+    ExpectEq("(counter)", "2");
+    ExpectEq("((make-counter))", "1");
+}
+
+TEST_CASE_METHOD(SchemeTest, "FramePerCall") {
+    ExpectNoError("(define (fact n) (if (= n 0) 1 (* n (fact (- n 1)))))");
+    ExpectEq("(fact 10)", "3628800");
+    ExpectNoError("(define (adder n) (lambda (m) (+ n m)))");
+    ExpectNoError("(define add-one (adder 1))");
+    ExpectNoError("(define add-two (adder 2))");
+    ExpectEq("(list (add-one 10) (add-two 10))", "(11 12)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "FramesAreReused") {
+    ExpectNoError("(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))");
+    ExpectNoError(
+        "(define (ack m n) (if (= m 0) (+ n 1) (if (= n 0) (ack (- m 1) 1) "
+        "(ack (- m 1) (ack m (- n 1))))))");
+
+    auto allocated_before = scheme.GetHeapStats().allocated_objects;
+    ExpectEq("(fib 20)", "6765");
+    ExpectEq("(ack 2 3)", "9");
+    auto allocated = scheme.GetHeapStats().allocated_objects - allocated_before;
+
+    //  Allocations are bounded by the recursion depth, not the number of calls
+    REQUIRE(allocated < 1000);
+
+    //  Captured frames are not reused
+    ExpectNoError("(define (adder n) (lambda (m) (+ n m)))");
+    ExpectNoError("(define add-one (adder 1))");
+    ExpectEq("(fib 10)", "55");
+    ExpectEq("(add-one 1)", "2");
+}
+
+TEST_CASE_METHOD(SchemeTest, "TailCallsRunInConstantSpace") {
+    ExpectNoError("(define (loop n) (if (= n 0) 'done (loop (- n 1))))");
+    ExpectNoError("(define (even n) (or (= n 0) (odd (- n 1))))");
+    ExpectNoError("(define (odd n) (and (not (= n 0)) (even (- n 1))))");
+
+    auto allocated_before = scheme.GetHeapStats().allocated_objects;
+    ExpectEq("(loop 10000000)", "done");
+    ExpectEq("(even 100001)", "#f");
+    auto allocated = scheme.GetHeapStats().allocated_objects - allocated_before;
+
+    //  Neither the C++ stack nor the heap grows with the number of iterations
+    REQUIRE(allocated < 1000);
+}
+
+struct TreeWalkerTest : SchemeTest {
+    TreeWalkerTest() : SchemeTest(Engine::TREE_WALKER) {
+    }
+};
+
+TEST_CASE_METHOD(TreeWalkerTest, "DeepRecursionIsLimitedByStack") {
+    ExpectNoError("(define (range a b) (if (= a b) '() (cons a (range (+ a 1) b))))");
+    ExpectEq("(list-ref (range 0 1000) 999)", "999");
+
+    //  Raises an error instead of overflowing the C++ stack
+    ExpectRuntimeError("(range 0 10000000)");
+
+    scheme.SetStackBudget(64 << 10);
+    ExpectRuntimeError("(range 0 1000)");
+
+    //  The interpreter is usable after the error
+    ExpectEq("(list-ref (range 0 10) 9)", "9");
+    ExpectNoError("(define (loop n) (if (= n 0) 0 (loop (- n 1))))");
+    ExpectEq("(loop 200000)", "0");
+}
+
+TEST_CASE_METHOD(TreeWalkerTest, "DeepNestingIsLimitedByStack") {
+    //  Forms nested this deeply are read without recursion, but analysis and
+    //  execution recurse on the C++ stack
+    constexpr size_t kDepth = 50000;
+    auto nest = [](const std::string& open, size_t depth) {
+        std::string form;
+        for (size_t it = 0; it < depth; ++it) {
+            form += open;
+        }
+        return form + "0" + std::string(depth, ')');
+    };
+
+    ExpectRuntimeError(nest("(+ 1 ", kDepth));
+    ExpectRuntimeError(nest("(if #t ", kDepth));
+    ExpectRuntimeError(nest("(and #t ", kDepth));
+    ExpectRuntimeError("((lambda (x) " + nest("(+ x ", kDepth) + ") 1)");
+
+    //  The interpreter is usable after the error
+    ExpectEq(nest("(+ 1 ", 1000), "1000");
+}
@@ -0,0 +1,75 @@
+#include <test/scheme_test.h>
+
+#include <string>
+
+TEST_CASE_METHOD(SchemeTest, "PrimitivesEvaluateArgumentsOnce") {
+    ExpectNoError("(define x 1)");
+    ExpectNoError("(define y 'x)");
+
+    //  A quoted symbol is a symbol, not the value of the variable it names
+    ExpectRuntimeError("(+ 'x 1)");
+    ExpectRuntimeError("(< y 2)");
+    ExpectRuntimeError("(abs 'x)");
+    ExpectEq("(+ x 1)", "2");
+
+    ExpectEq("(- 10 1 2)", "7");
+    ExpectEq("(/ 20 2 5)", "2");
+    ExpectRuntimeError("(/ 1 0)");
+    ExpectEq("(<= 1 1 2)", "#t");
+    ExpectEq("(> 3 2 2)", "#f");
+    ExpectEq("(max 1 3 2)", "3");
+
+    ExpectRuntimeError("(car 1)");
+    ExpectRuntimeError("(cons 1)");
+    ExpectRuntimeError("(abs 1 2)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "ListPrimitives") {
+    ExpectEq("(list? '(a \"b\" (1 2)))", "#t");
+    ExpectEq("(list? '())", "#t");
+    ExpectEq("(list? '(a . b))", "#f");
+    ExpectEq("(list? 'a)", "#f");
+
+    ExpectEq("(list 'a (list) 1)", "(a () 1)");
+    ExpectEq("(list-ref '(a b c) 1)", "b");
+    ExpectEq("(list-tail '(a b c) 3)", "()");
+    ExpectRuntimeError("(list-ref '(a b c) 3)");
+    ExpectRuntimeError("(list-ref '(a b c) -1)");
+    ExpectRuntimeError("(list-tail '(a b c) 'a)");
+    ExpectRuntimeError("(list?)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "CallsDoNotAllocate") {
+    ExpectNoError("(define (sum a b c) (+ a b c))");
+    ExpectNoError("(define (loop n) (if (= n 0) 0 (loop (- (sum n n n) n n 1))))");
+    ExpectEq("(loop 10)", "0");
+
+    //  Reading and analysis allocate the same in both runs, the calls never
+    auto count = [this](const std::string& expression) {
+        auto before = scheme.GetHeapStats().allocated_objects;
+        ExpectEq(expression, "0");
+        return scheme.GetHeapStats().allocated_objects - before;
+    };
+    REQUIRE(count("(loop 1000)") == count("(loop 9999)"));
+}
+
+TEST_CASE_METHOD(SchemeTest, "MillionElementLists") {
+    constexpr int kSize = 1'000'000;
+
+    //  Quadratic or recursive traversal would not finish or overflow the stack
+    std::string elements;
+    for (int it = 0; it < kSize; ++it) {
+        elements += " " + std::to_string(it % 10);
+    }
+    ExpectNoError("(define numbers (list" + elements + "))");
+    ExpectNoError("(define quoted '(" + elements + "))");
+
+    ExpectEq("(list? numbers)", "#t");
+    ExpectEq("(list? quoted)", "#t");
+    ExpectEq("(list? (cons 1 numbers))", "#t");
+    ExpectEq("(list-ref numbers 999999)", "9");
+    ExpectEq("(list-tail quoted 999998)", "(8 9)");
+    ExpectRuntimeError("(list-ref numbers 1000000)");
+    ExpectEq("(list-tail numbers 1000000)", "()");
+    ExpectRuntimeError("(list-tail numbers 1000001)");
+}
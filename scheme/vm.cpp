@@ -0,0 +1,280 @@
+#include "vm.h"
+
+#include <string>
+
+#include <symbols.h>
+
+/*************  VmClosure  *************/
+VmClosure::VmClosure(VirtualMachine* vm, CodeObject* code, Environment* environment)
+    : Function(kSubtype), vm_(vm), code_(code), environment_(environment) {
+}
+
+Object* VmClosure::Apply(Scope*, Arguments args) {
+    return vm_->Call(this, args);
+}
+
+void VmClosure::Trace(Tracer* tracer) {
+    tracer->Visit(code_);
+    tracer->Visit(environment_);
+}
+
+CodeObject* VmClosure::GetCode() const {
+    return code_;
+}
+
+Environment* VmClosure::GetEnvironment() const {
+    return environment_;
+}
+
+/*************  VirtualMachine  *************/
+VirtualMachine::VirtualMachine(Scope* global_scope) : global_scope_(global_scope) {
+}
+
+Object* VirtualMachine::Execute(Object* form) {
+    Compiler compiler(global_scope_);
+    Handle<CodeObject> code = compiler.Compile(form);
+
+    auto entry = frames_.size();
+    PushFrame({code, 0, nullptr, stack_.size()});
+    return RunGuarded(entry);
+}
+
+Object* VirtualMachine::Call(VmClosure* closure, Arguments args) {
+    auto environment = MakeEnvironment(closure, args);
+
+    auto entry = frames_.size();
+    PushFrame({closure->GetCode(), 0, environment, stack_.size()});
+    return RunGuarded(entry);
+}
+
+void VirtualMachine::SetStackBudget(size_t bytes) {
+    stack_budget_ = bytes;
+}
+
+void VirtualMachine::Trace(Tracer* tracer) {
+    tracer->Visit(global_scope_);
+    for (auto& value : stack_) {
+        tracer->Visit(value);
+    }
+    for (auto& frame : frames_) {
+        tracer->Visit(frame.code);
+        tracer->Visit(frame.environment);
+    }
+}
+
+Object* VirtualMachine::RunGuarded(size_t entry) {
+    try {
+        return Run(entry);
+    } catch (...) {
+        stack_.resize(frames_[entry].base);
+        frames_.resize(entry);
+        throw;
+    }
+}
+
+Environment* VirtualMachine::MakeEnvironment(VmClosure* closure, Arguments args) {
+    auto code = closure->GetCode();
+    if (args.size() != code->arity) {
+        throw RuntimeError("lambda: wrong number of arguments");
+    }
+
+    auto environment = FramePool::Current().Acquire(closure->GetEnvironment(), code->frame_size);
+    for (size_t it = 0; it < args.size(); ++it) {
+        environment->Set(it, args[it]);
+    }
+    return environment;
+}
+
+void VirtualMachine::PushFrame(const Frame& frame) {
+    auto used = (frames_.size() + 1) * sizeof(Frame) + stack_.size() * sizeof(Object*);
+    if (used > stack_budget_) {
+        throw RuntimeError("vm: stack budget of " + std::to_string(stack_budget_) +
+                           " bytes exceeded");
+    }
+    frames_.push_back(frame);
+}
+
+void VirtualMachine::ReleaseFrame() {
+    if (auto environment = frames_.back().environment) {
+        FramePool::Current().Release(environment);
+    }
+    frames_.pop_back();
+}
+
+Object* VirtualMachine::Run(size_t entry) {
+    while (true) {
+        auto frame = &frames_.back();
+        auto& instruction = frame->code->code[frame->ip++];
+
+        switch (instruction.opcode) {
+            case Opcode::CONSTANT:
+                stack_.push_back(frame->code->constants[instruction.operand]);
+                break;
+
+            case Opcode::LOAD_LOCAL:
+                stack_.push_back(frame->environment->Get(instruction.operand));
+                break;
+
+            case Opcode::LOAD_CLOSURE: {
+                auto environment = frame->environment->GetAncestor(instruction.depth);
+                stack_.push_back(environment->Get(instruction.operand));
+                break;
+            }
+
+            case Opcode::LOAD_GLOBAL: {
+                auto name = static_cast<Symbol*>(frame->code->constants[instruction.operand]);
+                stack_.push_back(global_scope_->Lookup(name));
+                break;
+            }
+
+            case Opcode::STORE_LOCAL:
+                frame->environment->Set(instruction.operand, stack_.back());
+                break;
+
+            case Opcode::STORE_CLOSURE: {
+                auto environment = frame->environment->GetAncestor(instruction.depth);
+                environment->Set(instruction.operand, stack_.back());
+                break;
+            }
+
+            case Opcode::SET_GLOBAL: {
+                auto name = static_cast<Symbol*>(frame->code->constants[instruction.operand]);
+                global_scope_->Set(name, stack_.back());
+                break;
+            }
+
+            case Opcode::DEFINE_GLOBAL: {
+                auto name = static_cast<Symbol*>(frame->code->constants[instruction.operand]);
+                global_scope_->Insert(name, stack_.back());
+                break;
+            }
+
+            case Opcode::POP:
+                stack_.pop_back();
+                break;
+
+            case Opcode::JUMP:
+                frame->ip = instruction.operand;
+                break;
+
+            case Opcode::JUMP_IF_FALSE: {
+                auto value = stack_.back();
+                stack_.pop_back();
+                if (!value || IsFalse(value)) {
+                    frame->ip = instruction.operand;
+                }
+                break;
+            }
+
+            case Opcode::JUMP_IF_FALSE_OR_POP:
+                if (IsFalse(stack_.back())) {
+                    frame->ip = instruction.operand;
+                } else {
+                    stack_.pop_back();
+                }
+                break;
+
+            case Opcode::JUMP_IF_TRUE_OR_POP:
+                if (!IsFalse(stack_.back())) {
+                    frame->ip = instruction.operand;
+                } else {
+                    stack_.pop_back();
+                }
+                break;
+
+            case Opcode::MAKE_CLOSURE: {
+                auto code = frame->code->functions[instruction.operand];
+                if (frame->environment) {
+                    frame->environment->MarkCaptured();
+                }
+                stack_.push_back(Make<VmClosure>(this, code, frame->environment));
+                break;
+            }
+
+            case Opcode::CALL:
+            case Opcode::TAIL_CALL: {
+                bool tail = instruction.opcode == Opcode::TAIL_CALL;
+                auto count = instruction.operand;
+                auto base = stack_.size() - count - 1;
+
+                Function* fn = nullptr;
+                if (IsFunction(stack_[base])) {
+                    fn = AsFunction(stack_[base]);
+                } else {
+                    //  The arguments are evaluated already (see the class comment)
+                    if (IsSyntax(stack_[base])) {
+                        throw RuntimeError("vm: syntax can not be called at run time");
+                    }
+
+                    if (count != 0) {
+                        //  Extra check for a lambda function;
+                        stack_[base] = EvalObject(stack_[base], global_scope_);
+                        if (!IsFunction(stack_[base])) {
+                            throw RuntimeError(
+                                "list: for 1st element, expected a function or "
+                                "a syntax; got: " +
+                                Print(stack_[base]));
+                        }
+                        fn = AsFunction(stack_[base]);
+                    }
+                }
+
+                if (auto closure = ExactCast<VmClosure>(fn)) {
+                    auto environment =
+                        MakeEnvironment(closure, Arguments(stack_.data() + base + 1, count));
+                    if (tail) {
+                        base = frames_.back().base;
+                        ReleaseFrame();
+                    }
+                    stack_.resize(base);
+                    PushFrame({closure->GetCode(), 0, environment, base});
+                    break;
+                }
+
+                //  Without arguments a non-function value is the result itself
+                Object* result = stack_[base];
+                if (fn) {
+                    //  Primitives may call back into the machine (load does),
+                    //  which may reallocate the stack, so the arguments are
+                    //  passed in storage which does not move
+                    ArgumentWindow args(Arguments(stack_.data() + base + 1, count));
+                    result = fn->Apply(global_scope_, args);
+                }
+
+                if (!tail) {
+                    stack_.resize(base);
+                    stack_.push_back(result);
+                    break;
+                }
+
+                //  Apply may have called back into the machine, so the frame
+                //  pointer is stale
+                stack_.resize(frames_.back().base);
+                ReleaseFrame();
+                if (frames_.size() == entry) {
+                    return result;
+                }
+                stack_.push_back(result);
+                break;
+            }
+
+            case Opcode::RETURN: {
+                auto result = stack_.back();
+                stack_.resize(frame->base);
+                ReleaseFrame();
+                if (frames_.size() == entry) {
+                    return result;
+                }
+                stack_.push_back(result);
+                break;
+            }
+
+            case Opcode::EVAL: {
+                //  The value stays on the stack while it is evaluated
+                auto result = Execute(stack_.back());
+                stack_.back() = result;
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <bytecode.h>
+#include <heap.h>
+#include <parser.h>
+#include <scope.h>
+
+class VirtualMachine;
+
+class VmClosure final : public Function {
+public:
+    static constexpr ObjectSubtype kSubtype = ObjectSubtype::VM_CLOSURE;
+
+    VmClosure(VirtualMachine* vm, CodeObject* code, Environment* environment);
+
+    Object* Apply(Scope* scope, Arguments args) override;
+    void Trace(Tracer* tracer) override;
+    CodeObject* GetCode() const;
+    Environment* GetEnvironment() const;
+
+private:
+    VirtualMachine* vm_;
+    CodeObject* code_;
+    Environment* environment_;
+};
+
+//  Stack machine executing compiled code. Calls between compiled lambdas
+//  do not recurse on the C++ stack, so the depth of recursion is limited
+//  only by the stack budget; exceeding it raises RuntimeError. The machine
+//  is a root for the collector: its value stack and frames keep their
+//  objects alive.
+//
+//  Unlike the tree walker, the machine does not call syntax values which
+//  only turn up at run time, like a global bound to `if` after the call was
+//  compiled: the arguments are already evaluated by then, so such a call
+//  raises RuntimeError.
+class VirtualMachine : public RootBase {
+public:
+    static constexpr size_t kDefaultStackBudget = size_t{256} << 20;
+
+    explicit VirtualMachine(Scope* global_scope);
+
+    //  Compiles a top-level form and runs it
+    Object* Execute(Object* form);
+    Object* Call(VmClosure* closure, Arguments args);
+
+    //  Bytes of frames and values which pending calls may occupy
+    void SetStackBudget(size_t bytes);
+
+private:
+    struct Frame {
+        CodeObject* code;
+        size_t ip;
+        Environment* environment;
+        //  Stack size before the call, the result replaces everything above
+        size_t base;
+    };
+
+    void Trace(Tracer* tracer) override;
+    Object* Run(size_t entry);
+    Object* RunGuarded(size_t entry);
+    Environment* MakeEnvironment(VmClosure* closure, Arguments args);
+    void PushFrame(const Frame& frame);
+    //  Pops the current frame, recycling its environment
+    void ReleaseFrame();
+
+    Scope* global_scope_;
+    std::vector<Object*> stack_;
+    std::vector<Frame> frames_;
+    size_t stack_budget_ = kDefaultStackBudget;
+};
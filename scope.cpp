@@ -1,24 +1,33 @@
 #include "scope.h"
 
+#include <algorithm>
+
 Scope::Scope() : previous_(nullptr) {
 }
 
-Scope::Scope(const std::shared_ptr<Scope>& previous) : previous_(previous) {
+Scope::Scope(Scope* previous) : previous_(previous) {
 }
 
-std::shared_ptr<Object> Scope::LookupInCurrentScope(const std::string& name) const {
-    auto it = variables_.find(name);
+void Scope::Trace(Tracer* tracer) {
+    tracer->Visit(previous_);
+    for (auto& [id, value] : variables_) {
+        tracer->Visit(value);
+    }
+}
+
+Object* Scope::LookupInCurrentScope(Symbol* name) const {
+    auto it = variables_.find(name->GetId());
     if (it == variables_.end()) {
         return nullptr;
     }
     return it->second;
 }
 
-std::shared_ptr<Scope> Scope::GetPreviousScope() const {
+Scope* Scope::GetPreviousScope() const {
     return previous_;
 };
 
-std::shared_ptr<Object> Scope::Lookup(const std::string& name) const {
+Object* Scope::Lookup(Symbol* name) const {
     auto result = LookupInCurrentScope(name);
     auto previous_scope = previous_;
 
@@ -28,17 +37,17 @@ std::shared_ptr<Object> Scope::Lookup(const std::string& name) const {
     }
 
     if (!result) {
-        throw NameError(name);
+        throw NameError(name->GetName());
     } else {
         return result;
     }
 }
 
-void Scope::Insert(const std::string& name, const std::shared_ptr<Object>& value) {
-    variables_[name] = value;
+void Scope::Insert(Symbol* name, Object* value) {
+    variables_[name->GetId()] = value;
 }
 
-void Scope::Set(const std::string& name, const std::shared_ptr<Object>& value) {
+void Scope::Set(Symbol* name, Object* value) {
     auto result = LookupInCurrentScope(name);
     if (result) {
         Insert(name, value);
@@ -55,9 +64,84 @@ void Scope::Set(const std::string& name, const std::shared_ptr<Object>& value) {
         previous_scope = previous_scope->GetPreviousScope();
     }
 
-    throw NameError(name);
+    throw NameError(name->GetName());
 }
 
 void Scope::Clear() {
     variables_.clear();
 }
+
+Environment::Environment(Environment* parent, size_t size)
+    : parent_(parent), size_(size), slots_(inline_slots_) {
+    if (size > kInlineSlots) {
+        overflow_slots_ = std::make_unique<Object*[]>(size);
+        slots_ = overflow_slots_.get();
+    }
+}
+
+void Environment::Trace(Tracer* tracer) {
+    tracer->Visit(parent_);
+    for (size_t it = 0; it < size_; ++it) {
+        tracer->Visit(slots_[it]);
+    }
+}
+
+Environment* Environment::GetParent() const {
+    return parent_;
+}
+
+void Environment::MarkCaptured() {
+    captured_ = true;
+}
+
+bool Environment::IsCaptured() const {
+    return captured_;
+}
+
+void Environment::Reset(Environment* parent, size_t size) {
+    parent_ = parent;
+    size_ = size;
+    captured_ = false;
+    std::fill(slots_, slots_ + kInlineSlots, nullptr);
+}
+
+Environment* Environment::GetAncestor(size_t depth) {
+    auto environment = this;
+    for (size_t it = 0; it < depth; ++it) {
+        environment = environment->parent_;
+    }
+    return environment;
+}
+
+FramePool& FramePool::Current() {
+    static thread_local FramePool pool;
+    return pool;
+}
+
+Environment* FramePool::Acquire(Environment* parent, size_t size) {
+    if (frames_.empty() || size > Environment::kInlineSlots) {
+        return Make<Environment>(parent, size);
+    }
+
+    auto environment = frames_.back();
+    frames_.pop_back();
+    environment->Reset(parent, size);
+    return environment;
+}
+
+void FramePool::Release(Environment* environment) {
+    if (environment->IsCaptured() || environment->overflow_slots_ ||
+        frames_.size() == kMaxFrames) {
+        return;
+    }
+
+    //  Do not keep the values of the finished call alive
+    environment->Reset(nullptr, 0);
+    frames_.push_back(environment);
+}
+
+void FramePool::Trace(Tracer* tracer) {
+    for (auto& environment : frames_) {
+        tracer->Visit(environment);
+    }
+}
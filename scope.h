@@ -1,24 +1,87 @@
 #pragma once
 
-#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
 #include <unordered_map>
 
+#include <heap.h>
 #include <parser.h>
 
 class Object;
+class Symbol;
 
-class Scope {
+class Scope : public HeapObject {
 public:
     Scope();
-    Scope(const std::shared_ptr<Scope>& previous);
-    std::shared_ptr<Object> LookupInCurrentScope(const std::string& name) const;
-    std::shared_ptr<Scope> GetPreviousScope() const;
-    std::shared_ptr<Object> Lookup(const std::string& name) const;
-    void Insert(const std::string& name, const std::shared_ptr<Object>& value);
-    void Set(const std::string& name, const std::shared_ptr<Object>& value);
+    Scope(Scope* previous);
+    void Trace(Tracer* tracer) override;
+    Object* LookupInCurrentScope(Symbol* name) const;
+    Scope* GetPreviousScope() const;
+    Object* Lookup(Symbol* name) const;
+    void Insert(Symbol* name, Object* value);
+    void Set(Symbol* name, Object* value);
     void Clear();
 
 private:
-    std::unordered_map<std::string, std::shared_ptr<Object>> variables_;
-    std::shared_ptr<Scope> previous_ = nullptr;
+    //  Keyed by symbol ids
+    std::unordered_map<uint32_t, Object*> variables_;
+    Scope* previous_ = nullptr;
+};
+
+//  Frame of one lambda call. Variables of lambdas are resolved during
+//  analysis to a (depth, slot) pair: depth frames up the parent chain,
+//  then an index. Only globals live in a Scope.
+class Environment : public HeapObject {
+public:
+    Environment(Environment* parent, size_t size);
+    void Trace(Tracer* tracer) override;
+    Environment* GetParent() const;
+    Environment* GetAncestor(size_t depth);
+
+    //  Set once a closure is created over the frame, such frames can not
+    //  be reused
+    void MarkCaptured();
+    bool IsCaptured() const;
+
+    Object* Get(size_t slot) const {
+        return slots_[slot];
+    }
+
+    void Set(size_t slot, Object* value) {
+        slots_[slot] = value;
+    }
+
+private:
+    friend class FramePool;
+
+    //  Small frames need a single allocation
+    static constexpr size_t kInlineSlots = 4;
+
+    void Reset(Environment* parent, size_t size);
+
+    Environment* parent_;
+    size_t size_;
+    bool captured_ = false;
+    Object** slots_;
+    Object* inline_slots_[kInlineSlots] = {};
+    std::unique_ptr<Object*[]> overflow_slots_;
+};
+
+//  Recycles small frames which no closure captured, so calls do not
+//  allocate. Pooled frames are roots, so the collector keeps them.
+class FramePool : public RootBase {
+public:
+    static FramePool& Current();
+
+    Environment* Acquire(Environment* parent, size_t size);
+    void Release(Environment* environment);
+
+private:
+    static constexpr size_t kMaxFrames = 256;
+
+    void Trace(Tracer* tracer) override;
+
+    std::vector<Environment*> frames_;
 };
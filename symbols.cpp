@@ -1,11 +1,25 @@
 #include <symbols.h>
 
+True* True::Instance() {
+    static True instance;
+    return &instance;
+}
+
+Object* True::Eval(Scope*) {
+    return this;
+}
+
 True::True() : Symbol("#t") {
 }
 
-False::False() : Symbol("#f") {
+False* False::Instance() {
+    static False instance;
+    return &instance;
+}
+
+Object* False::Eval(Scope*) {
+    return this;
 }
 
-bool False::IsFalse() const {
-    return true;
+False::False() : Symbol("#f") {
 }
@@ -1,164 +1,157 @@
 #include "syntax.h"
 
-std::shared_ptr<Object> IfSynt::Apply(const std::shared_ptr<Scope>& scope,
-                                      const std::vector<std::shared_ptr<Object>>& args) {
+namespace {
+
+//  Name introduced by a (define ...) form, nullptr for other forms
+Symbol* DefinedName(Object* form, Analyzer* analyzer) {
+    if (!IsCell(form)) {
+        return nullptr;
+    }
+    if (!ExactCast<DefineSynt>(analyzer->LookupSyntax(AsCell(form)->GetFirst()))) {
+        return nullptr;
+    }
+
+    auto args = ToVector(AsCell(form)->GetSecond());
+    if (args.empty()) {
+        return nullptr;
+    }
+
+    auto name = IsCell(args[0]) ? AsCell(args[0])->GetFirst() : args[0];
+    return IsSymbol(name) ? AsSymbol(name) : nullptr;
+}
+
+}  // namespace
+
+Node* IfSynt::Analyze(Arguments args, Analyzer* analyzer) {
 
     if (args.size() < 2 || args.size() > 3) {
         throw SyntaxError("if: wrong number of arguments: " + std::to_string(args.size()));
     }
 
-    auto condition = args[0];
-    auto true_branch = args[1];
-    std::shared_ptr<Object> false_branch = nullptr;
+    Handle<Node> condition = analyzer->Analyze(args[0]);
+    Handle<Node> true_branch = analyzer->Analyze(args[1]);
+    Handle<Node> false_branch;
 
     if (args.size() == 3) {
-        false_branch = args[2];
+        false_branch = analyzer->Analyze(args[2]);
     }
 
-    auto result = condition->Eval(scope);
-    if (result && !result->IsFalse()) {
-        return true_branch->Eval(scope);
-    } else if (false_branch) {
-        return false_branch->Eval(scope);
-    } else {
-        return nullptr;
-    }
+    return Make<IfNode>(condition, true_branch, false_branch);
 }
 
-std::shared_ptr<Object> QuoteSynt::Apply(const std::shared_ptr<Scope>& scope,
-                                         const std::vector<std::shared_ptr<Object>>& args) {
+Node* QuoteSynt::Analyze(Arguments args, Analyzer*) {
 
     if (args.size() != 1) {
         throw RuntimeError("quote: wrong number of arguments: " + std::to_string(args.size()));
     }
 
-    return args[0];
+    return Make<ConstantNode>(args[0]);
 }
 
-std::shared_ptr<Object> LambdaSynt::Apply(const std::shared_ptr<Scope>& scope,
-                                          const std::vector<std::shared_ptr<Object>>& args) {
+Node* LambdaSynt::Analyze(Arguments args, Analyzer* analyzer) {
 
     if (args.empty()) {
         throw SyntaxError("lambda is empty");
     }
 
     //  Parse names of variables
-    std::vector<std::string> variables;
+    std::vector<Symbol*> variables;
     if (args[0]) {
         auto variables_as_objects = ToVector(args[0]);
         for (auto& var : variables_as_objects) {
-            auto name = std::dynamic_pointer_cast<Symbol>(var);
-            if (!var) {
+            if (!IsSymbol(var)) {
                 throw SyntaxError("lambda variables must be symbols");
             } else {
-                variables.push_back(name->GetName());
+                variables.push_back(AsSymbol(var));
             }
         }
     }
 
-    //  Save function body
-    std::vector<std::shared_ptr<Object>> body;
     if (args.size() < 2) {
         throw SyntaxError("lambda is missing function body");
-    } else {
-        body = std::vector(args.begin() + 1, args.end());
     }
 
-    //  Create LambdaClosure using names of variables, function body,
-    //  and its scope
-    auto result = LambdaClosure(variables, body, scope);
-    return std::make_shared<LambdaClosure>(result);
-}
-
-std::shared_ptr<Object> AndSynt::Apply(const std::shared_ptr<Scope>& scope,
-                                       const std::vector<std::shared_ptr<Object>>& args) {
-
-    for (auto& arg : args) {
-        auto current = arg->Eval(scope);
-        if (current->IsFalse()) {
-            return std::make_shared<False>();
+    //  Internal definitions are visible in the whole body
+    auto body = args.subspan(1);
+    analyzer->PushFrame(variables);
+    for (auto& form : body) {
+        if (auto name = DefinedName(form, analyzer)) {
+            analyzer->DeclareLocal(name);
         }
     }
 
-    if (args.empty()) {
-        return std::make_shared<True>();
-    } else {
-        return args.back()->Eval(scope);
-    }
+    //  Analyze function body once; every closure created from this lambda
+    //  shares the result
+    RootedVector<Node> nodes = analyzer->AnalyzeAll(body);
+    auto frame_size = analyzer->PopFrame();
+    nodes[nodes.size() - 1]->MarkTailPosition();
+
+    return Make<LambdaNode>(variables.size(), frame_size, nodes);
 }
 
-std::shared_ptr<Object> OrSynt::Apply(const std::shared_ptr<Scope>& scope,
-                                      const std::vector<std::shared_ptr<Object>>& args) {
+Node* AndSynt::Analyze(Arguments args, Analyzer* analyzer) {
+    return Make<AndNode>(analyzer->AnalyzeAll(args));
+}
 
-    for (auto& arg : args) {
-        auto current = arg->Eval(scope);
-        if (!current->IsFalse()) {
-            return current;
-        }
-    }
+Node* OrSynt::Analyze(Arguments args, Analyzer* analyzer) {
+    return Make<OrNode>(analyzer->AnalyzeAll(args));
+}
 
-    if (args.empty()) {
-        return std::make_shared<False>();
-    } else {
-        return args.back()->Eval(scope);
-    }
+DefineSynt::DefineSynt() : Syntax(kSubtype) {
 }
 
-std::shared_ptr<Object> DefineSynt::Apply(const std::shared_ptr<Scope>& scope,
-                                          const std::vector<std::shared_ptr<Object>>& args) {
+Node* DefineSynt::Analyze(Arguments args, Analyzer* analyzer) {
 
     if (args.size() != 2) {
         throw SyntaxError("define: wrong number of arguments: " + std::to_string(args.size()));
     }
 
-    auto name = std::dynamic_pointer_cast<Symbol>(args[0]);
-    auto cell = std::dynamic_pointer_cast<Cell>(args[0]);
-    if (cell) {
-        name = std::dynamic_pointer_cast<Symbol>(cell->GetFirst());
+    auto header = IsCell(args[0]) ? AsCell(args[0])->GetFirst() : args[0];
+    if (!IsSymbol(header)) {
+        throw SyntaxError("define: first argument must be a symbol or a cell");
     }
+    auto name = AsSymbol(header);
 
-    std::shared_ptr<Object> result;
-    if (!name && !cell) {
-        throw SyntaxError("define: first argument must be a symbol or a cell");
-    } else if (name && !cell) {
-        result = args[1]->Eval(scope);
+    Handle<Node> value;
+    if (!IsCell(args[0])) {
+        value = analyzer->Analyze(args[1]);
     } else {
         //  Deal with short syntax for a lambda function
-        std::vector<std::shared_ptr<Object>> new_args;
-        new_args.push_back(cell->GetSecond());
-        new_args.push_back(args[1]);
+        Object* new_args[] = {AsCell(args[0])->GetSecond(), args[1]};
         LambdaSynt lambda;
-        result = lambda.Apply(scope, new_args);
+        value = lambda.Analyze(new_args, analyzer);
     }
 
-    scope->Insert(name->GetName(), result);
-    return result;
+    if (analyzer->IsTopLevel()) {
+        return Make<DefineNode>(analyzer->GetScope(), name, value);
+    }
+    return Make<LocalSetNode>(0, analyzer->DeclareLocal(name), value);
 }
 
-std::shared_ptr<Object> SetSynt::Apply(const std::shared_ptr<Scope>& scope,
-                                       const std::vector<std::shared_ptr<Object>>& args) {
+Node* SetSynt::Analyze(Arguments args, Analyzer* analyzer) {
 
     if (args.size() != 2) {
         throw SyntaxError("set: wrong number of arguments: " + std::to_string(args.size()));
     }
 
-    auto name = std::dynamic_pointer_cast<Symbol>(args[0]);
-    if (!name) {
+    if (!IsSymbol(args[0])) {
         throw SyntaxError("set: first argument must be a symbol");
     }
+    auto name = AsSymbol(args[0]);
 
-    auto result = args[1]->Eval(scope);
-    scope->Set(name->GetName(), result);
-    return result;
+    Handle<Node> value = analyzer->Analyze(args[1]);
+    size_t depth, slot;
+    if (analyzer->Resolve(name, &depth, &slot)) {
+        return Make<LocalSetNode>(depth, slot, value);
+    }
+    return Make<SetNode>(analyzer->GetScope(), name, value);
 }
 
-std::shared_ptr<Object> EvalSynt::Apply(const std::shared_ptr<Scope>& scope,
-                                        const std::vector<std::shared_ptr<Object>>& args) {
+Node* EvalSynt::Analyze(Arguments args, Analyzer* analyzer) {
 
     if (args.size() != 1) {
         throw SyntaxError("EvalSynt: wrong number of arguments: " + std::to_string(args.size()));
     }
 
-    auto evaluated = args[0]->Eval(scope);
-    return evaluated->Eval(scope);
+    return Make<EvalNode>(analyzer->GetScope(), analyzer->Analyze(args[0]));
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <analyzer.h>
 #include <scope.h>
 #include <parser.h>
 #include <symbols.h>
@@ -7,48 +8,43 @@
 
 class IfSynt : public Syntax {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    Node* Analyze(Arguments args, Analyzer* analyzer) override;
 };
 
 class QuoteSynt : public Syntax {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    Node* Analyze(Arguments args, Analyzer* analyzer) override;
 };
 
 class LambdaSynt : public Syntax {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    Node* Analyze(Arguments args, Analyzer* analyzer) override;
 };
 
 class AndSynt : public Syntax {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    Node* Analyze(Arguments args, Analyzer* analyzer) override;
 };
 
 class OrSynt : public Syntax {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    Node* Analyze(Arguments args, Analyzer* analyzer) override;
 };
 
-class DefineSynt : public Syntax {
+class DefineSynt final : public Syntax {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    static constexpr ObjectSubtype kSubtype = ObjectSubtype::DEFINE_SYNTAX;
+
+    DefineSynt();
+    Node* Analyze(Arguments args, Analyzer* analyzer) override;
 };
 
 class SetSynt : public Syntax {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    Node* Analyze(Arguments args, Analyzer* analyzer) override;
 };
 
 class EvalSynt : public Syntax {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Scope>& scope,
-                                  const std::vector<std::shared_ptr<Object>>& args) override;
+    Node* Analyze(Arguments args, Analyzer* analyzer) override;
 };
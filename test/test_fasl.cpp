@@ -0,0 +1,123 @@
+#include <test/scheme_test.h>
+
+#include <fasl.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> PrintAll(const std::vector<Object*>& forms) {
+    std::vector<std::string> printed;
+    for (auto form : forms) {
+        printed.push_back(Print(form));
+    }
+    return printed;
+}
+
+std::string TempPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / (std::to_string(std::rand()) + name)).string();
+}
+
+}  // namespace
+
+TEST_CASE_METHOD(SchemeTest, "FaslKeepsForms") {
+    RootedVector<Object> forms;
+    scheme.ReadForms("-2 () sym #t \"a \\\" b\" "
+                     "(define (f x) (if (< x 0) '(a . b) (list x \"s\" f))) ((1 . 2) 3 . 4)",
+                     [&forms](Object* form) { forms.push_back(form); });
+
+    //  Numbers too large for a fixnum are boxed
+    for (auto expression : {"(* 2147483647 2147483647 2)", "(- 0 (* 2147483647 2147483647 2))"}) {
+        forms.push_back(scheme.Eval(scheme.ReadCommand(expression)));
+        REQUIRE(!IsFixnum(forms[forms.size() - 1]));
+    }
+
+    auto data = WriteFasl(static_cast<const std::vector<Object*>&>(forms));
+    REQUIRE(IsFasl(data));
+    auto copy = ReadFasl(data);
+    Heap::Current().Collect();
+    REQUIRE(PrintAll(copy) == PrintAll(forms));
+
+    //  Symbols are interned again
+    REQUIRE(copy[2] == Intern("sym"));
+    REQUIRE(copy[3] == True::Instance());
+}
+
+TEST_CASE_METHOD(SchemeTest, "FaslKeepsSharing") {
+    ExpectNoError("(define shared (list 1 2))");
+    ExpectNoError("(define pair (cons shared shared))");
+    ExpectNoError("(define loop (list 1 2 3))");
+    ExpectNoError("(set-cdr! (cdr (cdr loop)) loop)");
+
+    Object* forms[] = {scheme.Eval(scheme.ReadCommand("pair")),
+                       scheme.Eval(scheme.ReadCommand("loop"))};
+    auto copy = ReadFasl(WriteFasl(forms));
+    Heap::Current().Collect();
+
+    auto pair = AsCell(copy[0]);
+    REQUIRE(pair->GetFirst() == pair->GetSecond());
+    REQUIRE(Print(pair->GetFirst()) == "(1 2)");
+
+    auto loop = copy[1];
+    REQUIRE(AsCell(AsCell(AsCell(loop)->GetSecond())->GetSecond())->GetSecond() == loop);
+}
+
+TEST_CASE_METHOD(SchemeTest, "FaslHandlesLargeForms") {
+    constexpr int kSize = 1000000;
+
+    auto long_list = scheme.Eval(scheme.ReadCommand(
+        "((lambda (build) (build build 0 '())) "
+        "(lambda (self n tail) (if (= n 1000000) tail (self self (+ n 1) (cons n tail)))))"));
+    Handle<Object> nested = scheme.ReadCommand(std::string(kSize / 10, '(') + "1" +
+                                               std::string(kSize / 10, ')'));
+
+    Object* forms[] = {long_list, nested};
+    auto copy = ReadFasl(WriteFasl(forms));
+    int length = 0;
+    for (auto element : ListRange(copy[0])) {
+        length += element == MakeNumber(kSize - 1 - length);
+    }
+    REQUIRE(length == kSize);
+
+    int depth = 0;
+    for (Object* current = copy[1]; IsCell(current); current = AsCell(current)->GetFirst()) {
+        ++depth;
+    }
+    REQUIRE(depth == kSize / 10);
+}
+
+TEST_CASE_METHOD(SchemeTest, "FaslRejectsBadInput") {
+    Object* forms[] = {scheme.ReadCommand("(a \"b\" (c . 1))")};
+    auto data = WriteFasl(forms);
+
+    for (size_t size = 0; size < data.size(); ++size) {
+        REQUIRE_THROWS_AS(ReadFasl(data.substr(0, size)), RuntimeError);
+    }
+    REQUIRE_THROWS_AS(ReadFasl(data + "x"), RuntimeError);
+
+    Object* functions[] = {scheme.Eval(scheme.ReadCommand("car"))};
+    REQUIRE_THROWS_AS(WriteFasl(functions), RuntimeError);
+}
+
+TEST_CASE_METHOD(SchemeTest, "LoadCompiledFile") {
+    auto source = TempPath("_library.scm");
+    auto target = TempPath("_library.fasl");
+    {
+        std::ofstream file(source);
+        file << "(define (twice x) (* x 2))\n(define greeting \"hello\")\n(twice 21)\n";
+    }
+
+    scheme.CompileFile(source, target);
+    std::remove(source.c_str());
+
+    REQUIRE(Print(scheme.LoadFile(target)) == "42");
+    ExpectEq("greeting", "\"hello\"");
+    ExpectEq("(load \"" + target + "\")", "42");
+    std::remove(target.c_str());
+
+    REQUIRE_THROWS_AS(scheme.CompileFile(source, target), RuntimeError);
+}
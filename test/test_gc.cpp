@@ -0,0 +1,66 @@
+#include <test/scheme_test.h>
+
+TEST_CASE_METHOD(SchemeTest, "GarbageIsCollected") {
+    auto& heap = Heap::Current();
+    heap.Collect();
+    auto live_before = heap.GetStats().live_objects;
+
+    for (int i = 0; i < 100; ++i) {
+        ExpectNoError("(define f (lambda (x) (if (= x 0) 0 (f (- x 1)))))");
+        ExpectEq("(f 10)", "0");
+    }
+
+    heap.Collect();
+    auto stats = scheme.GetHeapStats();
+    REQUIRE(stats.live_objects < live_before + 100);
+    REQUIRE(stats.freed_objects > 0);
+    REQUIRE(stats.collections > 0);
+}
+
+TEST_CASE_METHOD(SchemeTest, "CollectOnEveryAllocation") {
+    Heap::Current().SetStressMode(true);
+    ExpectNoError("(define lst '(1 2 3))");
+    ExpectEq("(cons 0 lst)", "(0 1 2 3)");
+    ExpectNoError("(define adder (lambda (x) (lambda (y) (+ x y))))");
+    ExpectEq("((adder 2) 3)", "5");
+    ExpectEq("(list (+ 1 2) (* 2 3) (car lst))", "(3 6 1)");
+    Heap::Current().SetStressMode(false);
+}
+
+TEST_CASE_METHOD(SchemeTest, "PairsAreTwoWords") {
+    ExpectNoError("(define (range a b) (if (= a b) '() (cons a (range (+ a 1) b))))");
+    //  Fills the frame pool
+    ExpectNoError("(range 0 1000)");
+
+    auto& heap = Heap::Current();
+    heap.Collect();
+    auto live_before = heap.GetStats().live_bytes;
+
+    ExpectNoError("(define numbers (range 0 1000))");
+    heap.Collect();
+    REQUIRE(heap.GetStats().live_bytes - live_before == 1000 * 2 * sizeof(void*));
+
+    ExpectEq("(list-ref numbers 999)", "999");
+    ExpectEq("(list-tail numbers 998)", "(998 999)");
+    ExpectEq("(pair? numbers)", "#t");
+    ExpectEq("(pair? 1)", "#f");
+}
+
+TEST_CASE_METHOD(SchemeTest, "MillionElementListIsFreed") {
+    ExpectNoError("(define (build n acc) (if (= n 0) acc (build (- n 1) (cons n acc))))");
+    ExpectNoError("(build 10 '())");
+
+    auto& heap = Heap::Current();
+    heap.Collect();
+    auto live_before = heap.GetStats().live_bytes;
+
+    //  Collections during the build sweep lazily while the list grows
+    ExpectNoError("(define numbers (build 1000000 '()))");
+    ExpectEq("(list-ref numbers 999999)", "1000000");
+    heap.Collect();
+    REQUIRE(heap.GetStats().live_bytes - live_before >= 1000000 * 2 * sizeof(void*));
+
+    ExpectNoError("(set! numbers '())");
+    heap.Collect();
+    REQUIRE(heap.GetStats().live_bytes < live_before + 1024);
+}
@@ -0,0 +1,177 @@
+#include <test/scheme_test.h>
+
+#include <parallel_reader.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+TEST_CASE_METHOD(SchemeTest, "ReaderKeepsGrammar") {
+    ExpectEq("'(1 (2 3) . 4)", "(1 (2 3) . 4)");
+    ExpectEq("'(1 . (2 . (3 . ())))", "(1 2 3)");
+    ExpectEq("''a", "(quote a)");
+    ExpectEq("'(a 'b '(c))", "(a (quote b) (quote (c)))");
+    ExpectEq("'()", "()");
+
+    ExpectSyntaxError("(1 . 2 3)");
+    ExpectSyntaxError("(1 . )");
+    ExpectSyntaxError("( . 1)");
+    ExpectSyntaxError("(1 2");
+    ExpectSyntaxError(")");
+    ExpectSyntaxError("'");
+}
+
+namespace {
+
+//  Generates the same form over and over, without keeping the text
+class RepeatedForms : public std::streambuf {
+public:
+    RepeatedForms(std::string form, size_t count) : form_(std::move(form)), count_(count) {
+    }
+
+protected:
+    int_type underflow() override {
+        if (count_ == 0) {
+            return traits_type::eof();
+        }
+        --count_;
+        setg(form_.data(), form_.data(), form_.data() + form_.size());
+        return traits_type::to_int_type(form_[0]);
+    }
+
+private:
+    std::string form_;
+    size_t count_;
+};
+
+}  // namespace
+
+TEST_CASE_METHOD(SchemeTest, "ReadFormsYieldsTopLevelForms") {
+    std::vector<std::string> forms;
+    scheme.ReadForms("1 (a b)\n'c \"d\"", [&forms](Object* form) { forms.push_back(Print(form)); });
+    REQUIRE(forms == std::vector<std::string>{"1", "(a b)", "(quote c)", "\"d\""});
+
+    //  Forms before an error are delivered
+    forms.clear();
+    auto read = [&forms](Object* form) { forms.push_back(Print(form)); };
+    REQUIRE_THROWS_AS(scheme.ReadForms("(a) (b", read), SyntaxError);
+    REQUIRE(forms == std::vector<std::string>{"(a)"});
+}
+
+TEST_CASE_METHOD(SchemeTest, "ReadFormsRunsInConstantMemory") {
+    constexpr size_t kForms = 200000;
+    RepeatedForms source("(record 12345 (nested . pair) \"text\")\n", kForms);
+    std::istream in(&source);
+
+    auto& heap = Heap::Current();
+    size_t count = 0;
+    size_t peak = 0;
+    scheme.ReadForms(&in, [&](Object*) {
+        ++count;
+        peak = std::max(peak, heap.GetStats().live_bytes);
+    });
+
+    REQUIRE(count == kForms);
+    REQUIRE(heap.GetStats().collections > 0);
+    REQUIRE(peak < (4 << 20));
+}
+
+TEST_CASE_METHOD(SchemeTest, "ReaderReadsStrings") {
+    ExpectEq("\"abc\"", "\"abc\"");
+    ExpectEq("'(\"a b\" . \"\\\"\\\\\")", "(\"a b\" . \"\\\"\\\\\")");
+    ExpectEq("((lambda (x) x) \"\")", "\"\"");
+
+    ExpectSyntaxError("\"abc");
+    ExpectSyntaxError("(\"abc)");
+}
+
+TEST_CASE_METHOD(SchemeTest, "LoadEvaluatesFile") {
+    auto path = (std::filesystem::temp_directory_path() /
+                 ("scheme_load_" + std::to_string(std::rand()) + ".scm"))
+                    .string();
+    {
+        std::ofstream file(path);
+        file << "(define (twice x) (* x 2))\n"
+             << "(define value (twice 21))\n"
+             << "'(nested (list))  value\n";
+    }
+
+    REQUIRE(Print(scheme.LoadFile(path)) == "42");
+    ExpectEq("(twice value)", "84");
+
+    ExpectEq("(load \"" + path + "\")", "42");
+    ExpectRuntimeError("(load 'file)");
+    std::remove(path.c_str());
+    ExpectRuntimeError("(load \"" + path + "\")");
+    REQUIRE_THROWS_AS(scheme.LoadFile(path), RuntimeError);
+}
+
+TEST_CASE_METHOD(SchemeTest, "ReaderHandlesDeepNesting") {
+    constexpr int kDepth = 100000;
+
+    //  Every level is a list of one element, the innermost one is 1
+    auto lists = scheme.ReadCommand(std::string(kDepth, '(') + "1" + std::string(kDepth, ')'));
+    int depth = 0;
+    Object* current = lists;
+    while (IsCell(current) && !AsCell(current)->GetSecond()) {
+        current = AsCell(current)->GetFirst();
+        ++depth;
+    }
+    REQUIRE(depth == kDepth);
+    REQUIRE(Print(current) == "1");
+
+    //  Every level is (quote <next>)
+    auto quotes = scheme.ReadCommand(std::string(kDepth, '\'') + "(2 . 3)");
+    depth = 0;
+    current = quotes;
+    while (IsCell(current) && AsCell(current)->GetFirst() == Intern("quote")) {
+        current = AsCell(AsCell(current)->GetSecond())->GetFirst();
+        ++depth;
+    }
+    REQUIRE(depth == kDepth);
+    REQUIRE(Print(current) == "(2 . 3)");
+
+    REQUIRE_THROWS_AS(scheme.ReadCommand(std::string(kDepth, '(')), SyntaxError);
+}
+
+TEST_CASE("FormBoundariesKeepFormsWhole") {
+    //  Not inside a list or a string, after a quote or before a sign
+    std::string_view input = "(a \") \" b) 'c -1 d";
+    REQUIRE(FindFormBoundaries(input, 1) == std::vector<size_t>{0, 11, 17, 18});
+    REQUIRE(FindFormBoundaries(input, 100) == std::vector<size_t>{0, 18});
+    //  Nor in the spaces before a sign
+    REQUIRE(FindFormBoundaries("(a)  -5 (b) \n +7", 1) == std::vector<size_t>{0, 8, 16});
+    REQUIRE(FindFormBoundaries("", 1) == std::vector<size_t>{0, 0});
+}
+
+TEST_CASE_METHOD(SchemeTest, "ParallelReadKeepsOrder") {
+    std::string input;
+    for (int it = 0; input.size() < (1 << 20); ++it) {
+        input += "(form " + std::to_string(it) + " \"a ) \\\" (\" '(b . c))\n' (x) -5 ab12 ";
+        //  Signs after runs of spaces, which are symbols here
+        input += "(y)" + std::string(it % 7 + 1, ' ') + "-5 \n\t+7 ";
+        //  Strings longer than a block of the structural index
+        input += "\"" + std::string(it % 150, ')') + "\\\\\\\"(\" ";
+    }
+
+    std::vector<std::string> expected;
+    scheme.ReadForms(input, [&expected](Object* form) { expected.push_back(Print(form)); });
+
+    //  About 64 KB each
+    REQUIRE(FindFormBoundaries(input, 1 << 16).size() > 16);
+
+    auto forms = ReadFormsParallel(input, 4);
+    Heap::Current().Collect();
+    REQUIRE(forms.size() == expected.size());
+    size_t mismatches = 0;
+    for (size_t it = 0; it < forms.size(); ++it) {
+        mismatches += Print(forms[it]) != expected[it];
+    }
+    REQUIRE(mismatches == 0);
+
+    REQUIRE_THROWS_AS(ReadFormsParallel(input + " (unfinished", 4), SyntaxError);
+}
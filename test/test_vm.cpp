@@ -0,0 +1,163 @@
+#include <test/scheme_test.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+struct BytecodeTest : SchemeTest {
+    BytecodeTest() : SchemeTest(Engine::BYTECODE) {
+    }
+};
+
+namespace {
+
+//  Runs its first argument on the machine, then returns the second one
+class ReenterFunction : public Function {
+public:
+    explicit ReenterFunction(VirtualMachine* vm) : vm_(vm) {
+    }
+
+    Object* Apply(Scope*, Arguments args) override {
+        vm_->Execute(args[0]);
+        return args[1];
+    }
+
+private:
+    VirtualMachine* vm_;
+};
+
+Object* ReadForm(const std::string& text) {
+    Tokenizer tokenizer{std::string_view(text)};
+    return Read(&tokenizer);
+}
+
+}  // namespace
+
+TEST_CASE_METHOD(BytecodeTest, "BytecodeSpecialForms") {
+    ExpectEq("(+ 1 (* 2 3))", "7");
+    ExpectEq("(if #f 1 2)", "2");
+    ExpectEq("(if #f 1)", "()");
+    ExpectEq("(and 1 2 3)", "3");
+    ExpectEq("(and 1 #f 3)", "#f");
+    ExpectEq("(or #f 2 3)", "2");
+    ExpectEq("(or)", "#f");
+    ExpectEq("'(1 2)", "(1 2)");
+    ExpectNoError("(define x 1)");
+    ExpectEq("(set! x (+ x 1))", "2");
+    ExpectEq("x", "2");
+    ExpectEq("(eval '(+ x 3))", "5");
+    ExpectSyntaxError("(if)");
+    ExpectNameError("(set! y 1)");
+    ExpectRuntimeError("(car '())");
+}
+
+TEST_CASE_METHOD(BytecodeTest, "BytecodeClosures") {
+    ExpectNoError(
+        "(define make-counter (lambda () (define n 0) (lambda () (set! n (+ n 1)) n)))");
+    ExpectNoError("(define first (make-counter))");
+    ExpectNoError("(define second (make-counter))");
+    ExpectEq("(first)", "1");
+    ExpectEq("(first)", "2");
+    ExpectEq("(second)", "1");
+    ExpectEq("(((lambda (a) (lambda (b) (+ a b))) 2) 3)", "5");
+    ExpectRuntimeError("((lambda (x) x))");
+}
+
+TEST_CASE_METHOD(BytecodeTest, "BytecodeRecursion") {
+    ExpectNoError("(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))");
+    ExpectEq("(fib 20)", "6765");
+    ExpectNoError("(define (range a b) (if (= a b) '() (cons a (range (+ a 1) b))))");
+    ExpectEq("(range 0 5)", "(0 1 2 3 4)");
+}
+
+TEST_CASE_METHOD(BytecodeTest, "BytecodeTailCalls") {
+    ExpectNoError("(define (loop n) (if (= n 0) 'done (loop (- n 1))))");
+    ExpectEq("(loop 1000000)", "done");
+    ExpectNoError("(define (even n) (or (= n 0) (odd (- n 1))))");
+    ExpectNoError("(define (odd n) (and (not (= n 0)) (even (- n 1))))");
+    ExpectEq("(even 100001)", "#f");
+}
+
+TEST_CASE_METHOD(BytecodeTest, "SyntaxValuesAreNotCalled") {
+    ExpectNoError("(define (choose) (my-if #t 1 (car '())))");
+    ExpectNoError("(define my-if if)");
+    ExpectRuntimeError("(choose)");
+
+    //  The tree walker analyzes the call with the syntax when it is made
+    SchemeTest walker(Engine::TREE_WALKER);
+    walker.ExpectNoError("(define (choose) (my-if #t 1 (car '())))");
+    walker.ExpectNoError("(define my-if if)");
+    walker.ExpectEq("(choose)", "1");
+}
+
+TEST_CASE_METHOD(BytecodeTest, "DeepRecursionIsLimitedByBudget") {
+    ExpectNoError("(define (range a b) (if (= a b) '() (cons a (range (+ a 1) b))))");
+
+    //  Far deeper than the C++ stack would allow
+    ExpectEq("(list-ref (range 0 200000) 199999)", "199999");
+
+    scheme.SetStackBudget(1 << 20);
+    ExpectRuntimeError("(range 0 200000)");
+
+    //  The machine is usable after the error
+    ExpectEq("(list-ref (range 0 1000) 999)", "999");
+    ExpectNoError("(define (loop n) (if (= n 0) 0 (loop (- n 1))))");
+    ExpectEq("(loop 200000)", "0");
+}
+
+TEST_CASE_METHOD(BytecodeTest, "DeepNestingIsCompiledWithinStack") {
+    //  The machine runs nested forms without recursion, but they are
+    //  analyzed and compiled on the C++ stack
+    constexpr size_t kDepth = 50000;
+    std::string form;
+    for (size_t it = 0; it < kDepth; ++it) {
+        form += "(+ 1 ";
+    }
+    form += "0" + std::string(kDepth, ')');
+    ExpectRuntimeError(form);
+
+    //  The limit does not depend on the budget of the machine
+    scheme.SetStackBudget(size_t{1} << 30);
+    ExpectRuntimeError(form);
+    ExpectEq("(+ 1 (+ 1 (+ 1 0)))", "3");
+}
+
+TEST_CASE_METHOD(BytecodeTest, "LoadReentersMachine") {
+    auto path = (std::filesystem::temp_directory_path() /
+                 ("scheme_reenter_" + std::to_string(std::rand()) + ".scm"))
+                    .string();
+    {
+        //  Grows the value stack far beyond its size at the call of load
+        std::ofstream file(path);
+        file << "(define (range a b) (if (= a b) '() (cons a (range (+ a 1) b))))\n"
+             << "(list-ref (range 0 100000) 99999)\n";
+    }
+
+    //  Every level keeps values on the stack while load runs
+    ExpectNoError("(define (nest n) (if (= n 0) (list n (load \"" + path + "\") (load \"" +
+                  path + "\")) (cdr (cons n (nest (- n 1))))))");
+    ExpectEq("(nest 10000)", "(0 99999 99999)");
+    std::remove(path.c_str());
+}
+
+TEST_CASE("PrimitivesMayReenterMachine") {
+    Handle<Scope> scope = Make<Scope>();
+    VirtualMachine vm(scope);
+    scope->Insert(Intern("define"), Make<DefineSynt>());
+    scope->Insert(Intern("if"), Make<IfSynt>());
+    scope->Insert(Intern("quote"), Make<QuoteSynt>());
+    scope->Insert(Intern("="), Make<EqualInt>());
+    scope->Insert(Intern("+"), Make<AddInt>());
+    scope->Insert(Intern("cons"), Make<ConsList>());
+    scope->Insert(Intern("reenter"), Make<ReenterFunction>(&vm));
+
+    Handle<Object> form =
+        ReadForm("(define (range a b) (if (= a b) '() (cons a (range (+ a 1) b))))");
+    vm.Execute(form);
+
+    //  The nested run grows the value stack before the second argument is read
+    form = ReadForm("(reenter '(range 0 100000) 42)");
+    REQUIRE(Print(vm.Execute(form)) == "42");
+}
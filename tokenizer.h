@@ -1,16 +1,26 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstdint>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <string>
-#include <cctype>  // std::isdigit
+#include <string_view>
 #include <memory>
 #include <variant>
 
+#include <structural_index.h>
+
 struct NullToken {};
 
+//  Refers to the input of the tokenizer: valid until the next call of
+//  Tokenizer::Next(), or as long as the buffer a tokenizer scans.
 struct SymbolToken {
-    std::string name;
+    std::string_view name;
 };
 
 struct QuoteToken {};
@@ -26,10 +36,19 @@ struct ConstantToken {
     int value;
 };
 
+//  Text between double quotes, escapes are not processed. An unterminated
+//  string runs to the end of the input.
+struct StringToken {
+    std::string_view text;
+    bool terminated;
+};
+
 // Чтобы следовать принципу DRY, заводим typedef.
 // Когда в будущем добавится новый вариант токена, будет
 // достаточно поменять определение в одном месте.
-typedef std::variant<NullToken, SymbolToken, QuoteToken, DotToken, BracketToken, ConstantToken> Token;
+typedef std::variant<NullToken, SymbolToken, QuoteToken, DotToken, BracketToken, ConstantToken,
+                     StringToken>
+    Token;
 
 inline bool operator==(NullToken, NullToken) {
     return true;
@@ -51,11 +70,12 @@ inline bool operator==(ConstantToken lhs, ConstantToken rhs) {
     return lhs.value == rhs.value;
 }
 
-inline bool CheckSymbol(char ch) {
-    return (ch != '.' && ch != '\'' && ch != '(' && ch != ')' && ch != ' ' &&
-            ch != '\n');
+inline bool operator==(StringToken lhs, StringToken rhs) {
+    return lhs.text == rhs.text && lhs.terminated == rhs.terminated;
 }
 
+//  Scans a contiguous buffer. The buffer is either the whole input, or it is
+//  filled from a stream as far as the current token requires.
 class Tokenizer {
 public:
     // Создаёт токенизатор читающий символы из потока in.
@@ -63,6 +83,11 @@ public:
         Next();
     }
 
+    //  Scans the input in place, it must outlive the tokens
+    explicit Tokenizer(std::string_view input) : input_(input) {
+        Next();
+    }
+
     // Достигли мы конца потока или нет.
     bool IsEnd() {
         return is_end_;
@@ -71,36 +96,31 @@ public:
     // Попытаться прочитать следующий токен.
     // Либо IsEnd() станет false, либо токен можно будет получить через Token().
     void Next() {
-        int next_item = in_->peek();
+        pos_ += token_size_;
+        token_size_ = 0;
 
         //  Skip spaces
-        while (next_item != EOF && (static_cast<char>(next_item) == ' ' ||
-               static_cast<char>(next_item) == '\n')) {
-            char ch;
-            in_->get(ch);
-            next_item = in_->peek();
-        }
+        auto spaces = SkipClass(0, kSpaceChar);
+        pos_ += spaces;
+
+        int ch = Peek(0);
 
         // Deal with end of stream
-        if (next_item == EOF) {
+        if (ch == kEnd) {
             is_end_ = true;
             token_ = NullToken{};
             return;
         }
 
         //  Deal with positive numbers
-        if (std::isdigit(next_item)) {
-            int number;
-            *in_ >> number;
-            token_ = ConstantToken{number};
+        if (HasCharClass(ch, kDigitChar)) {
+            token_ = ConstantToken{ScanNumber(0)};
             possible_unary_sign_ = false;
             return;
         }
 
         //  Deal with all non-number single symbols
-        char ch;
-        in_->get(ch);
-        next_item = in_->peek();
+        token_size_ = 1;
 
         if (ch == '\'') {
             token_ = QuoteToken{};
@@ -126,50 +146,137 @@ public:
             return;
         }
 
-        if (ch == '-' && possible_unary_sign_ && std::isdigit(next_item)) {
-            int number;
-            *in_ >> number;
-            token_ = ConstantToken{(-1) * number};
+        if (ch == '"') {
+            token_ = ScanString();
             possible_unary_sign_ = false;
             return;
         }
 
-        if (ch == '+' && possible_unary_sign_ && std::isdigit(next_item)) {
-            int number;
-            *in_ >> number;
-            token_ = ConstantToken{number};
+        if ((ch == '-' || ch == '+') && possible_unary_sign_ && HasCharClass(Peek(1), kDigitChar)) {
+            auto number = ScanNumber(1);
+            token_ = ConstantToken{ch == '-' ? -number : number};
             possible_unary_sign_ = false;
             return;
         }
 
         if (ch == '+' || ch == '-' || ch == '*') {
-            token_ = SymbolToken{std::string(1, ch)};
+            token_ = SymbolToken{input_.substr(pos_, 1)};
             possible_unary_sign_ = false;
             return;
         }
 
         //  Deal with multichar operators
-        std::string buffer;
-        buffer += ch;
-
-        while (next_item != EOF && !std::isdigit(next_item) &&
-               CheckSymbol(static_cast<char>(next_item))) {
-            char ch;
-            in_->get(ch);
-            buffer += ch;
-            next_item = in_->peek();
-        }
+        token_size_ = SkipClass(token_size_, kSymbolTailChar);
 
-        token_ = SymbolToken{buffer};
+        token_ = SymbolToken{input_.substr(pos_, token_size_)};
     }
 
     // Получить текущий токен.
-    Token GetToken() {
+    const Token& GetToken() const {
         return token_;
     }
 
 private:
-    std::istream* in_;
+    static constexpr int kEnd = std::char_traits<char>::eof();
+    static constexpr size_t kChunkSize = 64 << 10;
+
+    //  Character at the given offset from the current token, kEnd after the
+    //  end of the input
+    int Peek(size_t offset) {
+        while (pos_ + offset >= input_.size()) {
+            if (!Refill()) {
+                return kEnd;
+            }
+        }
+        return static_cast<unsigned char>(input_[pos_ + offset]);
+    }
+
+    //  Offset of the first character from the given offset on which is not
+    //  of the class, or of the end of the input. Characters are looked up in
+    //  the structural index of their block.
+    size_t SkipClass(size_t offset, uint8_t char_class) {
+        while (true) {
+            auto position = pos_ + offset;
+            if (position >= input_.size()) {
+                if (!Refill()) {
+                    return offset;
+                }
+                continue;
+            }
+
+            if (position - block_start_ >= block_size_) {
+                block_start_ = position - position % kBlockSize;
+                block_size_ = std::min(kBlockSize, input_.size() - block_start_);
+                block_ = Classify(input_.data() + block_start_, block_size_);
+            }
+
+            auto index = position - block_start_;
+            auto others = ~block_.Of(char_class) >> index;
+            auto found = static_cast<size_t>(std::countr_zero(others));
+            if (found < block_size_ - index) {
+                return offset + found;
+            }
+            offset += block_size_ - index;
+        }
+    }
+
+    //  Reads what the stream has available, waiting for at least one
+    //  character. The part before the current token is dropped.
+    bool Refill() {
+        auto buffer = in_ ? in_->rdbuf() : nullptr;
+        if (!buffer || buffer->sgetc() == kEnd) {
+            return false;
+        }
+
+        buffer_.erase(0, pos_);
+        pos_ = 0;
+        auto size = buffer_.size();
+        auto available = std::clamp<std::streamsize>(buffer->in_avail(), 1, kChunkSize);
+        buffer_.resize(size + available);
+        buffer_.resize(size + buffer->sgetn(buffer_.data() + size, available));
+        input_ = buffer_;
+        block_size_ = 0;
+        return buffer_.size() > size;
+    }
+
+    //  Digits start at the given offset; the token ends after them
+    int ScanNumber(size_t offset) {
+        token_size_ = SkipClass(offset, kDigitChar);
+
+        auto digits = input_.substr(pos_ + offset, token_size_ - offset);
+        int number = 0;
+        auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), number);
+        if (error == std::errc::result_out_of_range) {
+            number = std::numeric_limits<int>::max();
+        }
+        return number;
+    }
+
+    //  The opening quote is the first character of the token
+    StringToken ScanString() {
+        int ch;
+        while ((ch = Peek(token_size_)) != kEnd && ch != '"') {
+            token_size_ += (ch == '\\' && Peek(token_size_ + 1) != kEnd) ? 2 : 1;
+        }
+
+        StringToken token{input_.substr(pos_ + 1, token_size_ - 1), ch == '"'};
+        if (token.terminated) {
+            ++token_size_;
+        }
+        return token;
+    }
+
+    std::istream* in_ = nullptr;
+    //  Owns the input read from the stream
+    std::string buffer_;
+    std::string_view input_;
+    //  The current token starts at pos_
+    size_t pos_ = 0;
+    size_t token_size_ = 0;
+    //  Structural index of the block of input_ last looked at
+    CharMasks block_;
+    size_t block_start_ = 0;
+    size_t block_size_ = 0;
     Token token_;
     bool possible_unary_sign_ = true;
     bool is_end_ = false;
@@ -3,6 +3,8 @@
 #include <tokenizer.h>
 
 #include <sstream>
+#include <string>
+#include <vector>
 
 TEST_CASE("Tokenizer works on simple case") {
     std::stringstream ss{"4+)'."};
@@ -117,4 +119,150 @@ TEST_CASE("Empty string handled correctly") {
     Tokenizer tokenizer{&ss};
 
     REQUIRE(tokenizer.IsEnd());
-}
\ No newline at end of file
+}
+TEST_CASE("Tokenizer scans a buffer in place") {
+    std::string input = "(foo\t-12 . bar7)";
+    Tokenizer tokenizer{std::string_view(input)};
+
+    std::vector<Token> expected = {BracketToken::OPEN, SymbolToken{"foo"}, ConstantToken{-12},
+                                   DotToken{},         SymbolToken{"bar"}, ConstantToken{7},
+                                   BracketToken::CLOSE};
+    for (const auto& token : expected) {
+        REQUIRE(!tokenizer.IsEnd());
+        REQUIRE(tokenizer.GetToken() == token);
+        if (auto symbol = std::get_if<SymbolToken>(&tokenizer.GetToken())) {
+            REQUIRE(symbol->name.data() >= input.data());
+            REQUIRE(symbol->name.data() < input.data() + input.size());
+        }
+        tokenizer.Next();
+    }
+    REQUIRE(tokenizer.IsEnd());
+}
+
+TEST_CASE("Tokens span reads from the stream") {
+    std::string name(200000, 'x');
+    std::stringstream ss{name + " 1234567 " + name};
+    Tokenizer tokenizer{&ss};
+
+    REQUIRE(tokenizer.GetToken() == Token{SymbolToken{name}});
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{ConstantToken{1234567}});
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{SymbolToken{name}});
+    tokenizer.Next();
+    REQUIRE(tokenizer.IsEnd());
+}
+
+TEST_CASE("String literals") {
+    std::stringstream ss{"\"a \\\" b\"foo\"\" \"open"};
+    Tokenizer tokenizer{&ss};
+
+    REQUIRE(tokenizer.GetToken() == Token{StringToken{"a \\\" b", true}});
+
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{SymbolToken{"foo"}});
+
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{StringToken{"", true}});
+
+    tokenizer.Next();
+    REQUIRE(tokenizer.GetToken() == Token{StringToken{"open", false}});
+
+    tokenizer.Next();
+    REQUIRE(tokenizer.IsEnd());
+}
+
+TEST_CASE("Structural index matches character classes") {
+    //  Every byte value at every position of a block
+    std::string bytes;
+    for (size_t it = 0; it < 256 + kBlockSize; ++it) {
+        bytes += static_cast<char>(it * 7);
+    }
+
+    size_t mismatches = 0;
+    for (size_t it = 0; it + kBlockSize <= bytes.size(); ++it) {
+        auto block = ClassifyBlock(bytes.data() + it);
+        auto scalar = ClassifyScalar(bytes.data() + it, kBlockSize);
+        for (size_t bit = 0; bit < kBlockSize; ++bit) {
+            auto ch = static_cast<unsigned char>(bytes[it + bit]);
+            auto expected = kCharClasses[ch];
+            auto check = [&](uint64_t mask, bool is_set) { mismatches += ((mask >> bit) & 1) != is_set; };
+            for (auto& masks : {block, scalar}) {
+                check(masks.space, expected & kSpaceChar);
+                check(masks.digit, expected & kDigitChar);
+                check(masks.symbol_tail, expected & kSymbolTailChar);
+                check(masks.open, ch == '(');
+                check(masks.close, ch == ')');
+                check(masks.quote, ch == '\'');
+                check(masks.string, ch == '"');
+                check(masks.escape, ch == '\\');
+            }
+        }
+    }
+    REQUIRE(mismatches == 0);
+
+    //  Bits past the end are clear
+    REQUIRE(Classify("a b", 3).symbol_tail == 0b101);
+    REQUIRE(Classify("a b", 3).space == 0b010);
+}
+
+namespace {
+
+//  Hands out a few characters at a time
+class TrickleBuffer : public std::streambuf {
+public:
+    TrickleBuffer(std::string text, size_t step) : text_(std::move(text)), step_(step) {
+    }
+
+protected:
+    int_type underflow() override {
+        if (next_ == text_.size()) {
+            return traits_type::eof();
+        }
+        auto size = std::min(step_, text_.size() - next_);
+        setg(text_.data() + next_, text_.data() + next_, text_.data() + next_ + size);
+        next_ += size;
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    std::string text_;
+    size_t step_;
+    size_t next_ = 0;
+};
+
+std::vector<std::string> ReadAll(Tokenizer* tokenizer) {
+    std::vector<std::string> tokens;
+    for (; !tokenizer->IsEnd(); tokenizer->Next()) {
+        auto& token = tokenizer->GetToken();
+        if (auto symbol = std::get_if<SymbolToken>(&token)) {
+            tokens.emplace_back(symbol->name);
+        } else if (auto constant = std::get_if<ConstantToken>(&token)) {
+            tokens.push_back(std::to_string(constant->value));
+        } else {
+            tokens.push_back("#" + std::to_string(token.index()));
+        }
+    }
+    return tokens;
+}
+
+}  // namespace
+
+TEST_CASE("Tokens across blocks and reads") {
+    std::string text;
+    for (int it = 0; it < 300; ++it) {
+        text += "(sym" + std::string(it % 70, 'x') + " " + std::to_string(it * 977) + "  '(a . -" +
+                std::to_string(it) + ")" + std::string(it % 90, ' ') + "\"str\")\n";
+    }
+
+    Tokenizer in_place{std::string_view(text)};
+    auto expected = ReadAll(&in_place);
+    REQUIRE(expected.size() == 300 * 12);
+
+    for (size_t step : {1, 5, 64, 1000}) {
+        TrickleBuffer buffer(text, step);
+        std::istream in(&buffer);
+        Tokenizer tokenizer{&in};
+        REQUIRE(ReadAll(&tokenizer) == expected);
+    }
+}